@@ -0,0 +1,118 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace util {
+
+/// Запросы-чтения и запросы-команды получают отказ по отдельным порогам
+enum class RequestKind : std::uint8_t {
+    READ,
+    WRITE,
+    COUNT
+};
+
+struct AdmissionBudget {
+    /// сколько запросов этого вида может ждать в очереди исполнителя; 0 - без ограничения
+    std::size_t max_queued = 0;
+    /// отказ, если последняя запущенная задача ждала дольше и очередь не пуста; 0 - без ограничения
+    std::chrono::milliseconds max_wait{ 0 };
+};
+
+struct AdmissionLimits {
+    AdmissionBudget reads;
+    AdmissionBudget writes;
+    /// значение Retry-After в ответе 503
+    std::chrono::seconds retry_after{ 1 };
+
+    const AdmissionBudget& For(RequestKind kind) const noexcept {
+        return kind == RequestKind::READ ? reads : writes;
+    }
+};
+
+/// Сумма по исполнителям для отчёта
+struct AdmissionStats {
+    std::array<std::size_t, static_cast<std::size_t>(RequestKind::COUNT)> queued{};
+    std::array<std::uint64_t, static_cast<std::size_t>(RequestKind::COUNT)> shed{};
+    std::chrono::microseconds max_last_wait{ 0 };
+};
+
+/*
+ *  Admission control очереди одного исполнителя (strand-а).
+ *  Запрос сначала проходит TryEnqueue: если очередь его вида слишком длинная или задачи в ней ждут дольше порога,
+ *  он сразу получает отказ и не занимает исполнитель. Принятый запрос вызывает OnStart, когда начинает выполняться:
+ *  так известны и глубина очереди, и сколько в ней ждут.
+ *  Все методы можно вызывать из любых потоков; пороги проверяются без блокировок и могут быть превышены на число гонок.
+ */
+class AdmissionQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit AdmissionQueue(const AdmissionLimits& limits) noexcept
+        : limits_(limits) {
+    }
+
+    AdmissionQueue(const AdmissionQueue&) = delete;
+    AdmissionQueue& operator=(const AdmissionQueue&) = delete;
+
+    /// true - запрос учтён в очереди, после запуска нужен OnStart; false - отказ учтён в счётчике
+    bool TryEnqueue(RequestKind kind) noexcept {
+        const auto index = static_cast<std::size_t>(kind);
+        const auto& budget = limits_.For(kind);
+
+        /// оба вида ждут в одном strand-е: задержку создают все задачи перед новой
+        const bool waiting = queued_[0].load(std::memory_order_relaxed) + queued_[1].load(std::memory_order_relaxed) > 0;
+        if (waiting && budget.max_wait.count() > 0 && LastWait() > budget.max_wait) {
+            shed_[index].fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        const auto queued_before = queued_[index].fetch_add(1, std::memory_order_relaxed);
+        if (budget.max_queued > 0 && queued_before >= budget.max_queued) {
+            queued_[index].fetch_sub(1, std::memory_order_relaxed);
+            shed_[index].fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    /// Принятый запрос, поставленный в очередь в момент enqueued, начал выполняться
+    void OnStart(RequestKind kind, Clock::time_point enqueued) noexcept {
+        queued_[static_cast<std::size_t>(kind)].fetch_sub(1, std::memory_order_relaxed);
+        const auto wait = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - enqueued);
+        last_wait_us_.store(wait.count(), std::memory_order_relaxed);
+    }
+
+    std::size_t Queued(RequestKind kind) const noexcept {
+        return queued_[static_cast<std::size_t>(kind)].load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t Shed(RequestKind kind) const noexcept {
+        return shed_[static_cast<std::size_t>(kind)].load(std::memory_order_relaxed);
+    }
+
+    /// сколько ждал запуска последний запущенный запрос
+    std::chrono::microseconds LastWait() const noexcept {
+        return std::chrono::microseconds{ last_wait_us_.load(std::memory_order_relaxed) };
+    }
+
+    void AddTo(AdmissionStats& stats) const noexcept {
+        for (std::size_t i = 0; i < queued_.size(); ++i) {
+            stats.queued[i] += queued_[i].load(std::memory_order_relaxed);
+            stats.shed[i] += shed_[i].load(std::memory_order_relaxed);
+        }
+        if (LastWait() > stats.max_last_wait) {
+            stats.max_last_wait = LastWait();
+        }
+    }
+
+private:
+    const AdmissionLimits& limits_;
+    std::array<std::atomic<std::size_t>, static_cast<std::size_t>(RequestKind::COUNT)> queued_{};
+    std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(RequestKind::COUNT)> shed_{};
+    std::atomic<std::chrono::microseconds::rep> last_wait_us_{ 0 };
+};
+
+}  // namespace util
@@ -0,0 +1,185 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string_view>
+
+#include <boost/beast/http/verb.hpp>
+
+namespace http_handler {
+    using namespace std::literals;
+
+    struct ResponseAllowedMethods {
+        ResponseAllowedMethods() = delete;
+        constexpr static std::string_view GET_HEAD = "GET,HEAD"sv;
+        constexpr static std::string_view POST = "POST"sv;
+        constexpr static std::string_view GET_HEAD_POST = "GET,HEAD,POST"sv;
+    };
+
+    struct TargetAPI {
+        TargetAPI() = delete;
+
+        constexpr static std::string_view TARGET_MAPS = "/api/v1/maps"sv;
+        /// префикс /api/v1/maps/{map_id}
+        constexpr static std::string_view TARGET_SINGLE_MAP = "/api/v1/maps/"sv;
+        constexpr static std::string_view TARGET_JOIN = "/api/v1/game/join"sv;
+        /// вход многих игроков на одну карту одним запросом
+        constexpr static std::string_view TARGET_JOIN_BULK = "/api/v1/game/join/bulk"sv;
+        constexpr static std::string_view TARGET_PLAYERS = "/api/v1/game/players"sv;
+        constexpr static std::string_view TARGET_STATE = "/api/v1/game/state"sv;
+        constexpr static std::string_view TARGET_ACTION = "/api/v1/game/player/action"sv;
+        /// действия многих игроков одним запросом (боты, нагрузочные тесты)
+        constexpr static std::string_view TARGET_ACTIONS = "/api/v1/game/player/actions"sv;
+        constexpr static std::string_view TARGET_TICK = "/api/v1/game/tick"sv;
+        constexpr static std::string_view TARGET_RECORDS = "/api/v1/game/records"sv;
+        /// глубина очередей API и число отказов 503, см. admission_control.h
+        constexpr static std::string_view TARGET_ADMISSION = "/api/v1/game/admission"sv;
+        /// WebSocket: состояние сессии после каждого тика и приём действий игрока
+        constexpr static std::string_view TARGET_WS = "/api/v1/game/ws"sv;
+        constexpr static std::string_view TARGET_BAD = "/api/"sv;
+    };
+
+    /// Обработчик запроса API. Маршрут определяется один раз в RequestHandler и дальше передаётся как есть
+    enum class ApiRoute : std::uint8_t {
+        MAPS,
+        SINGLE_MAP,
+        JOIN,
+        JOIN_BULK,
+        PLAYERS,
+        STATE,
+        ACTION,
+        ACTIONS,
+        TICK,
+        RECORDS,
+        ADMISSION,
+    };
+
+    struct ApiRouteInfo {
+        constexpr static std::uint8_t GET = 1;
+        constexpr static std::uint8_t HEAD = 2;
+        constexpr static std::uint8_t POST = 4;
+
+        ApiRoute route;
+        std::string_view path;
+        std::uint8_t methods;
+        /// заголовок Allow ответа 405
+        std::string_view allow;
+        /// как маршрут назван в сообщении 405
+        std::string_view name;
+        /// обработчик читает параметры из строки запроса или имя карты из пути: target надо декодировать
+        bool reads_target;
+
+        constexpr bool Allows(boost::beast::http::verb verb) const noexcept {
+            switch (verb) {
+            case boost::beast::http::verb::get:
+                return methods & GET;
+            case boost::beast::http::verb::head:
+                return methods & HEAD;
+            case boost::beast::http::verb::post:
+                return methods & POST;
+            default:
+                return false;
+            }
+        }
+    };
+
+    /*
+     *  Таблица маршрутов API и поиск в ней без аллокаций.
+     *  Точные пути ищутся по идеальному хешу: коллизии в таблице слотов проверяются при компиляции,
+     *  поэтому на запрос приходится один хеш пути и одно сравнение строк.
+     *  /api/v1/maps/{map_id} - единственный маршрут с параметром в пути, он проверяется по префиксу.
+     */
+    class ApiRoutes {
+    public:
+        ApiRoutes() = delete;
+
+        constexpr static std::uint8_t GET_HEAD = ApiRouteInfo::GET | ApiRouteInfo::HEAD;
+
+        constexpr static std::array<ApiRouteInfo, 11> routes = { {
+            { ApiRoute::MAPS, TargetAPI::TARGET_MAPS, GET_HEAD, ResponseAllowedMethods::GET_HEAD, TargetAPI::TARGET_MAPS, false },
+            { ApiRoute::SINGLE_MAP, TargetAPI::TARGET_SINGLE_MAP, GET_HEAD, ResponseAllowedMethods::GET_HEAD, "/maps/{map_id}"sv, true },
+            { ApiRoute::JOIN, TargetAPI::TARGET_JOIN, ApiRouteInfo::POST, ResponseAllowedMethods::POST, TargetAPI::TARGET_JOIN, false },
+            { ApiRoute::JOIN_BULK, TargetAPI::TARGET_JOIN_BULK, ApiRouteInfo::POST, ResponseAllowedMethods::POST, TargetAPI::TARGET_JOIN_BULK, false },
+            { ApiRoute::PLAYERS, TargetAPI::TARGET_PLAYERS, GET_HEAD, ResponseAllowedMethods::GET_HEAD, TargetAPI::TARGET_PLAYERS, false },
+            { ApiRoute::STATE, TargetAPI::TARGET_STATE, GET_HEAD, ResponseAllowedMethods::GET_HEAD, TargetAPI::TARGET_STATE, true },
+            { ApiRoute::ACTION, TargetAPI::TARGET_ACTION, ApiRouteInfo::POST, ResponseAllowedMethods::POST, TargetAPI::TARGET_ACTION, false },
+            { ApiRoute::ACTIONS, TargetAPI::TARGET_ACTIONS, ApiRouteInfo::POST, ResponseAllowedMethods::POST, TargetAPI::TARGET_ACTIONS, false },
+            { ApiRoute::TICK, TargetAPI::TARGET_TICK, ApiRouteInfo::POST, ResponseAllowedMethods::POST, TargetAPI::TARGET_TICK, false },
+            { ApiRoute::RECORDS, TargetAPI::TARGET_RECORDS, GET_HEAD, ResponseAllowedMethods::GET_HEAD, TargetAPI::TARGET_RECORDS, true },
+            { ApiRoute::ADMISSION, TargetAPI::TARGET_ADMISSION, GET_HEAD, ResponseAllowedMethods::GET_HEAD, TargetAPI::TARGET_ADMISSION, false },
+        } };
+
+        static constexpr const ApiRouteInfo& Info(ApiRoute route) noexcept {
+            return routes[static_cast<std::size_t>(route)];
+        }
+
+        /// path - декодированный путь без строки запроса
+        static constexpr std::optional<ApiRoute> Match(std::string_view path) noexcept {
+            const auto slot = slots_[Hash(path) % slot_count];
+            if (slot != empty_slot && routes[slot].path == path) {
+                return routes[slot].route;
+            }
+            const auto prefix = TargetAPI::TARGET_SINGLE_MAP;
+            if (path.size() > prefix.size() && path.substr(0, prefix.size()) == prefix) {
+                return ApiRoute::SINGLE_MAP;
+            }
+            return std::nullopt;
+        }
+
+        /// для static_assert после определения slots_: всё ли разложено без коллизий
+        static constexpr bool IsPerfect() noexcept {
+            std::size_t placed = 0;
+            for (auto slot : slots_) {
+                placed += slot != empty_slot;
+            }
+            return placed + 1 == routes.size();
+        }
+
+        /// Info индексирует routes значением ApiRoute
+        static constexpr bool IsOrdered() noexcept {
+            for (std::size_t i = 0; i < routes.size(); ++i) {
+                if (static_cast<std::size_t>(routes[i].route) != i) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        constexpr static std::size_t slot_count = 31;
+        constexpr static std::uint8_t empty_slot = 0xff;
+
+        /// FNV-1a
+        static constexpr std::uint32_t Hash(std::string_view str) noexcept {
+            std::uint32_t hash = 2166136261u;
+            for (char ch : str) {
+                hash = (hash ^ static_cast<unsigned char>(ch)) * 16777619u;
+            }
+            return hash;
+        }
+
+        static constexpr std::array<std::uint8_t, slot_count> MakeSlots() noexcept {
+            std::array<std::uint8_t, slot_count> slots{};
+            for (auto& slot : slots) {
+                slot = empty_slot;
+            }
+            for (std::size_t i = 0; i < routes.size(); ++i) {
+                if (routes[i].route != ApiRoute::SINGLE_MAP) {
+                    slots[Hash(routes[i].path) % slot_count] = static_cast<std::uint8_t>(i);
+                }
+            }
+            return slots;
+        }
+
+        /// индекс маршрута в routes по хешу пути, empty_slot - пути с таким хешем нет
+        static const std::array<std::uint8_t, slot_count> slots_;
+    };
+
+    inline constexpr std::array<std::uint8_t, ApiRoutes::slot_count> ApiRoutes::slots_ = ApiRoutes::MakeSlots();
+
+    static_assert(ApiRoutes::IsOrdered(), "routes must be listed in ApiRoute order: Info indexes by it");
+    static_assert(ApiRoutes::IsPerfect(), "route paths collide in the hash table: change slot_count");
+
+}  // namespace http_handler
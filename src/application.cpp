@@ -3,34 +3,94 @@
 namespace app {
 	std::atomic<std::uint64_t> Player::player_counter{0};
 	std::vector<PlayerSharedPtr> Players::players{};
-	Token RandomToken::get() {
+	std::shared_mutex Players::players_mutex;
+	Token TokenFromString(std::string_view str) {
+		auto from_hex = [](char ch) -> int {
+			if (ch >= '0' && ch <= '9') return ch - '0';
+			if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+			if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+			return -1;
+		};
+
+		detail::TokenBytes bytes{};
+		if (str.size() != bytes.size() * 2) {
+			throw std::invalid_argument("token must be 32 hex digits");
+		}
+		for (size_t i = 0; i < bytes.size(); i++) {
+			int hi = from_hex(str[2 * i]);
+			int lo = from_hex(str[2 * i + 1]);
+			if (hi < 0 || lo < 0) {
+				throw std::invalid_argument("token must be 32 hex digits");
+			}
+			bytes[i] = static_cast<std::uint8_t>((hi << 4) | lo);
+		}
+		return Token(bytes);
+	}
+
+	std::string TokenToString(const Token& token) {
+		constexpr std::string_view digits = "0123456789abcdef"sv;
+		std::string result;
+		result.reserve((*token).size() * 2);
+		for (auto byte : *token) {
+			result += digits[byte >> 4];
+			result += digits[byte & 0x0f];
+		}
+		return result;
+	}
 
-		std::random_device random_device_;
-		std::mt19937_64 generator1_(random_device_());
-		std::uniform_int_distribution<> dist(0, 15);
-		std::stringstream ss;
+	namespace {
+		Token MakeToken(std::mt19937_64& generator) {
+			detail::TokenBytes bytes;
+			for (size_t i = 0; i < bytes.size(); i += sizeof(std::uint64_t)) {
+				std::uint64_t random_value = generator();
+				for (size_t j = 0; j < sizeof(std::uint64_t); j++) {
+					bytes[i + j] = static_cast<std::uint8_t>(random_value >> (8 * j));
+				}
+			}
+			return Token(bytes);
+		}
 
-		for (int i = 0; i < 32; i++) {
-			ss << std::hex << dist(generator1_);
+		/// токены выдаются с нескольких strand-ов: генератор свой у каждого потока и сидируется один раз
+		std::mt19937_64& TokenGenerator() {
+			thread_local std::mt19937_64 generator{ std::random_device{}() };
+			return generator;
 		}
+	}  // namespace
+
+	Token RandomToken::get() {
+		return MakeToken(TokenGenerator());
+	}
+
+	std::vector<Token> RandomToken::get(std::size_t count) {
+		auto& generator = TokenGenerator();
 
-		return Token(ss.str());
+		std::vector<Token> tokens;
+		tokens.reserve(count);
+		for (size_t i = 0; i < count; i++) {
+			tokens.push_back(MakeToken(generator));
+		}
+		return tokens;
 	}
 	Player::Player() {
 		id = 0;
 	}
-	Player::Player(DogSharedPtr dog_, GameSessionSharedPtr session_) :dog(dog_), session(session_) {
-		token = RandomToken::get();
+	Player::Player(DogSharedPtr dog_, GameSessionSharedPtr session_) :Player(dog_, session_, RandomToken::get()) {
+	}
+	Player::Player(DogSharedPtr dog_, GameSessionSharedPtr session_, const Token& token_) :session(session_), dog(dog_), token(token_) {
 		id = player_counter++;
+		dog->SetPlayerId(id);
 	}
 	void Player::SetId(std::uint64_t id_) {
 		id = id_;
+		if (dog) {
+			dog->SetPlayerId(id);
+		}
 	}
 	Token Player::GetToken() const {
 		return token;
 	}
 	void Player::SetToken(const std::string& token_) {
-		token = Token(token_);
+		token = TokenFromString(token_);
 	}
 	std::string Player::GetId() const {
 		return std::to_string(id);
@@ -47,6 +107,12 @@ namespace app {
 	DogSharedPtr Player::GetDog() const {
 		return dog;
 	}
+	bool Player::IsRemoved() const noexcept {
+		return removed.load(std::memory_order_acquire);
+	}
+	void Player::MarkRemoved() noexcept {
+		removed.store(true, std::memory_order_release);
+	}
 
 	void Player::DoAction(ACTIONS action, const std::string& param) {
 		if (action == ACTIONS::MOVE) {
@@ -67,9 +133,10 @@ namespace app {
 			player_counter = id;
 		}
 	}
-	PlayerSharedPtr Players::AddPlayer(model::Game& game, const std::string& userName, const Map::Id& mapId) {
+	PlayerSharedPtr Players::AddPlayer(model::Game& game, const std::string& userName, Map::Index mapIndex) {
 		auto newDog = DogSharedPtr(new Dog(userName));
-		auto session = game.AddDogToSession(newDog, mapId);
+		auto session = game.AddDogToSession(newDog, mapIndex);
+		std::unique_lock lock(players_mutex);
 		if (session == std::nullopt) {
 			players.push_back(PlayerSharedPtr(new Player()));
 		}
@@ -79,7 +146,31 @@ namespace app {
 		}
 		return players.back();
 	}
+	std::vector<PlayerSharedPtr> Players::AddPlayers(model::Game& game, const std::vector<std::string>& userNames, Map::Index mapIndex) {
+		std::vector<DogSharedPtr> newDogs;
+		newDogs.reserve(userNames.size());
+		for (const auto& userName : userNames) {
+			newDogs.push_back(DogSharedPtr(new Dog(userName)));
+		}
+		auto session = game.AddDogsToSession(newDogs, mapIndex);
+		if (session == std::nullopt) {
+			return {};
+		}
+		auto tokens = RandomToken::get(newDogs.size());
+
+		std::vector<PlayerSharedPtr> newPlayers;
+		newPlayers.reserve(newDogs.size());
+		for (size_t i = 0; i < newDogs.size(); i++) {
+			newPlayers.push_back(PlayerSharedPtr(new Player(newDogs[i], session.value(), tokens[i])));
+		}
+
+		/// вставка диапазона - не больше одного перевыделения списка под всю пачку
+		std::unique_lock lock(players_mutex);
+		players.insert(players.end(), newPlayers.begin(), newPlayers.end());
+		return newPlayers;
+	}
 	std::optional<PlayerSharedPtr> Players::FindPlayerByToken(const Token& token) {
+		std::shared_lock lock(players_mutex);
 		for (auto& p : players) {
 			if (p->GetToken() == token) {
 				return p;
@@ -95,6 +186,7 @@ namespace app {
 		if (player == std::nullopt) {
 			return result;
 		}
+		std::shared_lock lock(players_mutex);
 		for (auto& p : players) {
 			if ((p.get()->GetSession()).get()->GetId() == ((player.value())->GetSession()).get()->GetId()) {
 				result.push_back(p);
@@ -103,26 +195,18 @@ namespace app {
 		return result;
 	}
 
-	 std::vector<LootSharedPtr> Players::FindLootsInSessionWithPlayerToken(const Token& token) {
-		 std::optional<PlayerSharedPtr> player = FindPlayerByToken(token);
-
-		 std::vector<LootSharedPtr> result;
-		 if (player == std::nullopt) {
-			 return {};
-		 }
-		 result = player.value()->GetSession()->GetLoots();
-		 return result;
-	 }
-
 	 void Players::RemovePlayerFromGameByDogId(std::uint64_t dog_id)
 	 {
+		 std::unique_lock lock(players_mutex);
 		 for (std::vector<PlayerSharedPtr>::iterator it = players.begin(); it != players.end();)
 		 {
 			 if (it->get()->GetDog()->GetId() == dog_id) {
 				 it->get()->GetSession()->RemoveDog(dog_id);
+				 it->get()->MarkRemoved();
 				 players.erase(it);
 				 break;
 			 }
+			 ++it;
 		 }
 		 
 		 return;
@@ -8,16 +8,25 @@
 #include <atomic>
 #include <optional>
 #include <map>
+#include <array>
+#include <shared_mutex>
+#include <string_view>
 
 namespace detail {
 	struct TokenTag {};
+	using TokenBytes = std::array<std::uint8_t, 16>;
 }  // namespace detail
 
-using Token = util::Tagged<std::string, detail::TokenTag>;
+/// Токен хранится как 16 байт. В hex-строку (32 символа) переводится только на границе HTTP/JSON.
+using Token = util::Tagged<detail::TokenBytes, detail::TokenTag>;
 namespace app {
 	using namespace std::literals;
 	using namespace model;
 
+	/// Бросает std::invalid_argument, если строка не 32 hex-символа
+	Token TokenFromString(std::string_view str);
+	std::string TokenToString(const Token& token);
+
 	class Player;
 	using PlayerSharedPtr = std::shared_ptr<Player>;
 	using DogSharedPtr = std::shared_ptr<Dog>;
@@ -27,6 +36,8 @@ namespace app {
 		RandomToken() = delete;
 
 		static Token get();
+		/// count токенов от одного генератора: для массового входа
+		static std::vector<Token> get(std::size_t count);
 	};
 
 	enum class ACTIONS {
@@ -37,6 +48,7 @@ namespace app {
 	public:
 		Player();
 		Player(DogSharedPtr dog_,GameSessionSharedPtr session_);
+		Player(DogSharedPtr dog_, GameSessionSharedPtr session_, const Token& token_);
 		void SetId(std::uint64_t id_);
 		Token GetToken() const ;
 		void SetToken(const std::string& token_);
@@ -47,23 +59,30 @@ namespace app {
 		DogSharedPtr GetDog() const;
 		void DoAction(ACTIONS action, const std::string& param);
 		void UpdatePlayerCounter();;
+		/// игрок удалён из списка игроков (собака ушла на покой); читается из потоков сокетов
+		bool IsRemoved() const noexcept;
+		void MarkRemoved() noexcept;
 
 	private:
 		static std::atomic<std::uint64_t> player_counter;
 		GameSessionSharedPtr session;
 		DogSharedPtr dog;
-		Token token{"00000000000000000000000000000000"s};
+		Token token{detail::TokenBytes{}};
 		uint64_t id;
+		std::atomic<bool> removed{ false };
 	};
 
 	class Players {
 	public:
 		Players() = delete;
-		static PlayerSharedPtr AddPlayer(model::Game & game, const std::string& userName, const Map::Id& mapId);
+		static PlayerSharedPtr AddPlayer(model::Game & game, const std::string& userName, Map::Index mapIndex);
+		/// Вход многих игроков на одну карту: собаки, токены и место в списке игроков готовятся разом
+		static std::vector<PlayerSharedPtr> AddPlayers(model::Game& game, const std::vector<std::string>& userNames, Map::Index mapIndex);
 		static std::optional<PlayerSharedPtr> FindPlayerByToken(const Token& token);
 		static std::vector<PlayerSharedPtr> FindPlayersInSessionWithToken(const Token& token);
-		static std::vector<LootSharedPtr> FindLootsInSessionWithPlayerToken(const Token& token);
-		static std::vector<PlayerSharedPtr> players;
 		static void RemovePlayerFromGameByDogId(std::uint64_t dogId);
+		static std::vector<PlayerSharedPtr> players;
+		/// API обрабатывается на нескольких strand-ах: поиск по токену под shared-блокировкой, изменения списка - под эксклюзивной
+		static std::shared_mutex players_mutex;
 	};
 }//namespace app
\ No newline at end of file
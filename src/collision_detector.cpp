@@ -23,8 +23,9 @@ CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D
 }
 
 /// https://github.com/cpppracticum/cpp-backend-tests-practicum/blob/april/tests/cpp/test_s03_gather-tests/collision_detector.cpp
-std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
-        std::vector<GatheringEvent> detected_events;
+std::pmr::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider,
+    std::pmr::memory_resource* resource) {
+        std::pmr::vector<GatheringEvent> detected_events(resource);
 
         static auto eq_pt = [](geom::Point2D p1, geom::Point2D p2) {
             return p1.x == p2.x && p1.y == p2.y;
@@ -3,6 +3,8 @@
 #include "geom.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <memory_resource>
 #include <vector>
 
 #include <type_traits>
@@ -62,6 +64,11 @@ template<typename T>
 concept ItemOrGatherer = std::is_same<collision_detector::Item, T>::value || std::is_same<collision_detector::Gatherer, T>::value;
 
 struct ConcreteProvider :collision_detector::ItemGathererProvider {
+    explicit ConcreteProvider(std::pmr::memory_resource* resource)
+        : items_(resource)
+        , gatherers_(resource) {
+    }
+
     template<ItemOrGatherer... ARGS>
     ConcreteProvider(ARGS... args) {
         ([&] {
@@ -113,12 +120,13 @@ struct ConcreteProvider :collision_detector::ItemGathererProvider {
     }
 
 private:
-    std::vector<collision_detector::Item> items_;
-    std::vector<collision_detector::Gatherer> gatherers_;
+    std::pmr::vector<collision_detector::Item> items_;
+    std::pmr::vector<collision_detector::Gatherer> gatherers_;
 };
 
 // Эту функцию вам нужно будет реализовать в соответствующем задании.
 // При проверке ваших тестов она не нужна - функция будет линковаться снаружи.
-std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
+std::pmr::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
 }  // namespace collision_detector
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "game_websocket.h"
+
+#include <boost/asio/post.hpp>
+
+namespace http_handler {
+
+    void StatePushHub::Subscribe(std::weak_ptr<GameWebSocket> socket) {
+        std::lock_guard lock(mutex_);
+        subscribers_.push_back(std::move(socket));
+    }
+
+    void StatePushHub::Broadcast() {
+        std::lock_guard lock(mutex_);
+        std::erase_if(subscribers_, [](const std::weak_ptr<GameWebSocket>& subscriber) {
+            auto socket = subscriber.lock();
+            if (socket == nullptr) {
+                return true;
+            }
+            socket->Notify();
+            return false;
+        });
+    }
+
+    void GameWebSocket::Accept(beast::tcp_stream&& stream, StringRequest&& request, ContextPtr context) {
+        std::string target = FromUrlEncoding(static_cast<std::string>(request.target()));
+        if (TargetPath(target) != TargetAPI::TARGET_WS) {
+            return Reject(std::move(stream), request, http::status::not_found, "badRequest"sv, "WebSocket is served only at /api/v1/game/ws"sv);
+        }
+
+        /// браузер не может выставить заголовки WebSocket-запроса, поэтому токен принимается и в строке запроса
+        std::string token = FindQueryParam(target, "token"sv).value_or(""s);
+        if (token.empty()) {
+            const std::string str_bearer("Bearer");
+            std::string authorization(request[http::field::authorization]);
+            if (auto pos = authorization.find(str_bearer); pos != std::string::npos) {
+                token = authorization.substr(pos + str_bearer.size());
+                std::erase(token, ' ');
+            }
+        }
+
+        std::optional<app::PlayerSharedPtr> player;
+        try {
+            player = app::Players::FindPlayerByToken(app::TokenFromString(token));
+        }
+        catch (std::invalid_argument&) {
+            return Reject(std::move(stream), request, http::status::unauthorized, FreqStr::invalidToken, "Error: token is wrong"sv);
+        }
+        if (player == std::nullopt || player.value()->GetSession() == nullptr) {
+            return Reject(std::move(stream), request, http::status::unauthorized, FreqStr::unknownToken, "Error: Player token has not been found"sv);
+        }
+
+        auto socket = std::make_shared<GameWebSocket>(std::move(stream), std::move(request), std::move(context), player.value());
+        socket->ws_.async_accept(socket->upgrade_request_,
+            beast::bind_front_handler(&GameWebSocket::OnAccept, socket));
+    }
+
+    void GameWebSocket::Reject(beast::tcp_stream&& stream, const StringRequest& request,
+                               http::status status, std::string_view code, std::string_view message) {
+        // до перехода на WebSocket соединение ещё HTTP, поэтому отказ - обычный HTTP-ответ
+        std::string body = json_loader::ToJsonAsString(FreqStr::code, code, FreqStr::message, message);
+        auto response = std::make_shared<StringResponse>(ResponseUtils::MakeResponse<StringResponse>(
+            status,
+            body,
+            body.size(),
+            request.version(),
+            false,
+            std::make_pair(http::field::content_type, ContentType::APPLICATION_JSON),
+            std::make_pair(http::field::cache_control, FreqStr::no_cache)));
+        auto safe_stream = std::make_shared<beast::tcp_stream>(std::move(stream));
+        http::async_write(*safe_stream, *response, [safe_stream, response](beast::error_code, std::size_t) {
+            beast::error_code ec;
+            safe_stream->socket().shutdown(tcp::socket::shutdown_send, ec);
+        });
+    }
+
+    GameWebSocket::GameWebSocket(beast::tcp_stream&& stream, StringRequest&& request, ContextPtr context, app::PlayerSharedPtr player)
+        : ws_(std::move(stream))
+        , upgrade_request_(std::move(request))
+        , context_(std::move(context))
+        , player_(std::move(player)) {
+        ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+    }
+
+    void GameWebSocket::Notify() {
+        net::post(ws_.get_executor(), [self = shared_from_this()] {
+            self->SendLatest();
+        });
+    }
+
+    void GameWebSocket::OnAccept(beast::error_code ec) {
+        upgrade_request_ = {};
+        if (ec) {
+            LOG(LOG::MESSAGE_DATA)
+                << "error"sv
+                << LOG::ToJson("code"sv, std::to_string(ec.value()),
+                               "text"sv, ec.message(),
+                               "where "sv, "websocket accept"sv)
+                << LOG::Flush;
+            return;
+        }
+        context_->hub->Subscribe(weak_from_this());
+        SendLatest();
+        Read();
+    }
+
+    void GameWebSocket::Read() {
+        ws_.async_read(read_buffer_, beast::bind_front_handler(&GameWebSocket::OnRead, shared_from_this()));
+    }
+
+    void GameWebSocket::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+        if (ec || closing_) {
+            // клиент закрыл соединение: подписка истечёт вместе с последним shared_ptr
+            return;
+        }
+        std::string message = beast::buffers_to_string(read_buffer_.data());
+        read_buffer_.consume(read_buffer_.size());
+
+        /// не объект JSON или нет поля move - сообщение игнорируется
+        if (auto move = json_loader::ParseRequestBody(message).move; move.has_value()) {
+            if (move == "L" || move == "R" || move == "U" || move == "D" || move == "") {
+                context_->submit([player = player_, move = std::move(move.value())] {
+                    player->DoAction(app::ACTIONS::MOVE, move);
+                });
+            }
+        }
+        Read();
+    }
+
+    void GameWebSocket::SendLatest() {
+        if (closing_) {
+            return;
+        }
+        if (writing_ != nullptr) {
+            dirty_ = true;
+            return;
+        }
+        if (player_->IsRemoved()) {
+            return Close();
+        }
+        auto snapshot = player_->GetSession()->GetSnapshot();
+        if (snapshot->tick == last_sent_tick_) {
+            return;
+        }
+        const auto since = last_sent_tick_;
+        if (since + 1 == snapshot->tick) {
+            writing_ = snapshot->GetBody(SessionSnapshot::CachedBody::STATE_SINCE_PREVIOUS_TICK, [&snapshot, since] {
+                return json_loader::GetStateSinceCase(*snapshot, since);
+            });
+        }
+        else {
+            writing_ = std::make_shared<const std::string>(json_loader::GetStateSinceCase(*snapshot, since));
+        }
+        last_sent_tick_ = snapshot->tick;
+
+        ws_.text(true);
+        ws_.async_write(net::buffer(*writing_), beast::bind_front_handler(&GameWebSocket::OnWrite, shared_from_this()));
+    }
+
+    void GameWebSocket::OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+        writing_.reset();
+        if (ec) {
+            return;
+        }
+        if (dirty_) {
+            dirty_ = false;
+            SendLatest();
+        }
+    }
+
+    void GameWebSocket::Close() {
+        closing_ = true;
+        ws_.async_close(websocket::close_reason(websocket::close_code::policy_error, "player retired"),
+            [self = shared_from_this()](beast::error_code) {
+            });
+    }
+
+}  // namespace http_handler
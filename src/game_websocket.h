@@ -0,0 +1,84 @@
+#pragma once
+
+#include "response_utils.h"
+#include "application.h"
+
+#include <boost/beast/websocket.hpp>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace http_handler {
+    namespace websocket = beast::websocket;
+
+    class GameWebSocket;
+
+    /*
+     *  Подписчики на рассылку состояния после тика.
+     *  Broadcast вызывается в потоке тика (Game::SetTickObserver), подписка - при подключении клиента.
+     *  Закрытые сокеты отписываются сами: от них остаются истёкшие weak_ptr, Broadcast их удаляет.
+     */
+    class StatePushHub {
+    public:
+        void Subscribe(std::weak_ptr<GameWebSocket> socket);
+        void Broadcast();
+
+    private:
+        std::mutex mutex_;
+        std::vector<std::weak_ptr<GameWebSocket>> subscribers_;
+    };
+
+    /*
+     *  WebSocket игрока: /api/v1/game/ws?token=<authToken> или с заголовком Authorization.
+     *  Токен проверяется один раз при подключении.
+     *  После каждого тика клиенту уходит то же, что отдаёт /state?sinceTick=<последний отправленный тик>.
+     *  Пока пишется предыдущее сообщение, тики не копятся: потом отправится только самое свежее состояние.
+     *  Клиент присылает {"move": "L"} - действие уходит в очередь команд игры, как и POST /action.
+     *  Когда игрок удалён из игры (собака ушла на покой), сокет закрывается с кодом policy_error.
+     */
+    class GameWebSocket : public std::enable_shared_from_this<GameWebSocket> {
+    public:
+        struct Context {
+            model::Game& game;
+            std::shared_ptr<StatePushHub> hub;
+            /// передаёт команду игре из правильного потока (см. RequestHandler::SubmitCommand)
+            std::function<void(model::Game::Command)> submit;
+        };
+        using ContextPtr = std::shared_ptr<const Context>;
+
+        static void Accept(beast::tcp_stream&& stream, StringRequest&& request, ContextPtr context);
+
+        GameWebSocket(beast::tcp_stream&& stream, StringRequest&& request, ContextPtr context, app::PlayerSharedPtr player);
+
+        /// Можно вызывать из любого потока: отправка выполняется в executor-е сокета
+        void Notify();
+
+    private:
+        static void Reject(beast::tcp_stream&& stream, const StringRequest& request,
+                           http::status status, std::string_view code, std::string_view message);
+
+        void OnAccept(beast::error_code ec);
+        void Read();
+        void OnRead(beast::error_code ec, std::size_t bytes_read);
+        void SendLatest();
+        void OnWrite(beast::error_code ec, std::size_t bytes_written);
+        void Close();
+
+        websocket::stream<beast::tcp_stream> ws_;
+        /// запрос Upgrade нужен до конца async_accept
+        StringRequest upgrade_request_;
+        ContextPtr context_;
+        app::PlayerSharedPtr player_;
+        beast::flat_buffer read_buffer_;
+        /// тело сообщения, которое сейчас пишется; nullptr - запись не идёт
+        SessionSnapshot::Body writing_;
+        /// во время записи пришёл новый тик
+        bool dirty_ = false;
+        /// начато закрытие: больше ничего не пишем
+        bool closing_ = false;
+        std::uint64_t last_sent_tick_ = 0;
+    };
+
+}  // namespace http_handler
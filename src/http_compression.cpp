@@ -0,0 +1,134 @@
+#include "http_compression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+
+#include <zlib.h>
+
+namespace http_compression {
+
+namespace {
+
+std::string_view Trim(std::string_view str) noexcept {
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+bool EqualsNoCase(std::string_view lhs, std::string_view rhs) noexcept {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](char l, char r) {
+        return std::tolower(static_cast<unsigned char>(l)) == std::tolower(static_cast<unsigned char>(r));
+    });
+}
+
+/// q в тысячных: "0.5" -> 500. Разобрать не удалось - 1000, как без q
+int ParseQuality(std::string_view params) noexcept {
+    while (!params.empty()) {
+        auto end = params.find(';');
+        auto param = Trim(params.substr(0, end));
+        params = end == std::string_view::npos ? std::string_view{} : params.substr(end + 1);
+        if (param.size() < 2 || (param[0] != 'q' && param[0] != 'Q') || param[1] != '=') {
+            continue;
+        }
+        double q = 1.;
+        auto value = param.substr(2);
+        if (auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), q); ec != std::errc{}) {
+            return 1000;
+        }
+        return static_cast<int>(std::clamp(q, 0., 1.) * 1000 + 0.5);
+    }
+    return 1000;
+}
+
+}  // namespace
+
+Encoding Negotiate(std::string_view accept_encoding) noexcept {
+    /// -1 - кодировка в заголовке не названа
+    int gzip = -1;
+    int deflate = -1;
+    int any = -1;
+    while (!accept_encoding.empty()) {
+        auto end = accept_encoding.find(',');
+        auto item = accept_encoding.substr(0, end);
+        accept_encoding = end == std::string_view::npos ? std::string_view{} : accept_encoding.substr(end + 1);
+
+        auto params = item.find(';');
+        auto name = Trim(item.substr(0, params));
+        int q = params == std::string_view::npos ? 1000 : ParseQuality(item.substr(params + 1));
+        if (EqualsNoCase(name, "gzip") || EqualsNoCase(name, "x-gzip")) {
+            gzip = q;
+        }
+        else if (EqualsNoCase(name, "deflate")) {
+            deflate = q;
+        }
+        else if (name == "*") {
+            any = q;
+        }
+    }
+    if (gzip < 0) {
+        gzip = any;
+    }
+    if (deflate < 0) {
+        deflate = any;
+    }
+    if (gzip <= 0 && deflate <= 0) {
+        return Encoding::IDENTITY;
+    }
+    return gzip >= deflate ? Encoding::GZIP : Encoding::DEFLATE;
+}
+
+std::string_view ToString(Encoding encoding) noexcept {
+    switch (encoding) {
+    case Encoding::GZIP:
+        return "gzip";
+    case Encoding::DEFLATE:
+        return "deflate";
+    default:
+        return {};
+    }
+}
+
+bool IsCompressible(std::string_view content_type) noexcept {
+    content_type = content_type.substr(0, content_type.find(';'));
+    return content_type.starts_with("text/")
+        || content_type == "application/json"
+        || content_type == "application/xml"
+        || content_type == "application/javascript"
+        || content_type == "application/octet-stream"
+        || content_type == "image/svg+xml"
+        || content_type == "image/bmp";
+}
+
+std::string Compress(std::string_view data, Encoding encoding, int level) {
+    if (encoding == Encoding::IDENTITY || encoding == Encoding::COUNT) {
+        throw std::invalid_argument("Compress: no compression requested");
+    }
+    /// 15 - окно 32 КБ; +16 - обёртка gzip вместо zlib
+    const int window_bits = encoding == Encoding::GZIP ? 15 + 16 : 15;
+
+    z_stream stream{};
+    if (deflateInit2(&stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Compress: deflateInit2 failed");
+    }
+    /// deflateBound - верхняя граница размера, поэтому хватает одного вызова deflate
+    std::string out(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    const int result = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END) {
+        throw std::runtime_error("Compress: deflate failed");
+    }
+    return out;
+}
+
+}  // namespace http_compression
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace http_compression {
+
+/// Кодировки тела ответа (Content-Encoding). Значение - индекс в кешах сжатых тел, IDENTITY - без сжатия
+enum class Encoding : std::uint8_t {
+    IDENTITY,
+    GZIP,
+    /// в HTTP "deflate" - поток zlib (RFC 1950), а не голый deflate
+    DEFLATE,
+    COUNT
+};
+
+/// Тела меньше этого не сжимаются: заголовок и хвост gzip съедают выигрыш
+constexpr std::size_t min_size = 256;
+
+/// Сжатие, которое один раз на тело (статика, карты) - медленнее, но плотнее
+constexpr int level_once = 9;
+/// Сжатие тел, которые меняются с каждым тиком
+constexpr int level_per_tick = 5;
+
+/*
+ *  Выбор кодировки по заголовку Accept-Encoding: "gzip, deflate;q=0.5, *;q=0".
+ *  Берётся кодировка с наибольшим q, при равенстве gzip. q=0 запрещает кодировку, * задаёт q неназванных.
+ *  Пустой заголовок или ни одной подходящей кодировки - IDENTITY.
+ */
+Encoding Negotiate(std::string_view accept_encoding) noexcept;
+
+/// Значение заголовка Content-Encoding, для IDENTITY - пустая строка
+std::string_view ToString(Encoding encoding) noexcept;
+
+/// Стоит ли сжимать тело такого типа: текст, JSON, XML, SVG, JS и двоичные данные без своего сжатия
+bool IsCompressible(std::string_view content_type) noexcept;
+
+/// Сжатое тело. Бросает std::runtime_error, если zlib не справился
+std::string Compress(std::string_view data, Encoding encoding, int level);
+
+}  // namespace http_compression
@@ -13,14 +13,27 @@ namespace http_server {
             beast::bind_front_handler(&SessionBase::Read, GetSharedThis()));
     }
 
-    SessionBase::SessionBase(tcp::socket&& socket)
-        : stream_(std::move(socket)) {
+    std::pmr::memory_resource* FieldsPool() {
+        static std::pmr::synchronized_pool_resource pool;
+        return &pool;
+    }
+
+    SessionBase::SessionBase(tcp::socket&& socket, UpgradeHandlerPtr upgrade_handler)
+        : stream_(std::move(socket))
+        , upgrade_handler_(std::move(upgrade_handler)) {
+        beast::error_code ec;
+        remote_endpoint_ = stream_.socket().remote_endpoint(ec);
     }
 
     void SessionBase::Read() {
         /* Асинхронное чтение запроса */
-        // Очищаем запрос от прежнего значения (метод Read может быть вызван несколько раз)
-        request_ = {};
+        if (reading_ || read_done_ || upgrade_waiting_ || InFlight() >= max_in_flight) {
+            // Очередь ответов полна: чтение возобновит OnWrite
+            return;
+        }
+        // Прежний запрос целиком ушёл обработчику (OnRead, Upgrade), его поля и тело уже не здесь:
+        // request_ пуст, и парсер пишет в него без пересоздания
+        reading_ = true;
         stream_.expires_after(30s);
         // Считываем request_ из stream_, используя buffer_ для хранения считанных данных
         http::async_read(stream_, buffer_, request_,
@@ -29,32 +42,88 @@ namespace http_server {
     }
 
     void SessionBase::OnRead(beast::error_code ec, std::size_t bytes_read) {
+        reading_ = false;
         if (ec == http::error::end_of_stream) {
-            // Нормальная ситуация - клиент закрыл соединение
-            return Close();
+            // Нормальная ситуация - клиент закрыл соединение. Ответы на уже прочитанные запросы дописываются
+            read_done_ = true;
+            if (InFlight() == 0) {
+                return Close();
+            }
+            return;
         }
         if (ec) {
+            read_done_ = true;
             return ReportError(ec, "read"sv);
         }
 
-        HandleRequest(std::move(request_), stream_.socket().remote_endpoint());
+        if (upgrade_handler_ && beast::websocket::is_upgrade(request_)) {
+            // Соединение уходит WebSocket-сессии, эта HTTP-сессия на нём заканчивается
+            upgrade_waiting_ = true;
+            return Upgrade();
+        }
+
+        // Ответ на запрос без keep-alive закроет соединение: запросы после него не читаются
+        read_done_ = !request_.keep_alive();
+        HandleRequest(std::move(request_), remote_endpoint_, next_request_++);
+        Read();
+    }
+
+    void SessionBase::WriteNext() {
+        if (writing_ || closed_) {
+            return;
+        }
+        auto& pending = pending_[next_write_ % max_in_flight];
+        if (InFlight() == 0 || pending.write == nullptr) {
+            // ответ на самый ранний запрос ещё не готов, готовые ответы на следующие ждут его
+            return;
+        }
+        writing_ = true;
+        std::exchange(pending.write, nullptr)(*this, pending.response);
     }
 
-    void SessionBase::OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    void SessionBase::OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+        writing_ = false;
+        auto& pending = pending_[next_write_++ % max_in_flight];
+        const bool close = pending.close;
+        pending.response = nullptr;
+        pending.slot.Reset();
+
         if (ec) {
+            read_done_ = true;
             return ReportError(ec, "write"sv);
         }
 
         if (close) {
             // Семантика ответа требует закрыть соединение
+            read_done_ = true;
+            return Close();
+        }
+
+        if (upgrade_waiting_) {
+            return Upgrade();
+        }
+        if (read_done_ && InFlight() == 0) {
+            // клиент закрыл свою сторону, и ответы на все его запросы записаны
             return Close();
         }
 
-        // Считываем следующий запрос
+        WriteNext();
+        // Освободилось место в очереди: считываем следующий запрос, если чтение стояло
         Read();
     }
 
+    void SessionBase::Upgrade() {
+        if (InFlight() != 0) {
+            // Upgrade дождётся в request_ ответов на запросы перед ним
+            return;
+        }
+        upgrade_waiting_ = false;
+        stream_.expires_never();
+        (*upgrade_handler_)(std::move(stream_), std::move(request_));
+    }
+
     void SessionBase::Close() {
+        closed_ = true;
         beast::error_code ec;
         stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
         if (ec) {
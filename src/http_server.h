@@ -2,12 +2,22 @@
 #include "sdk.h"
 
 #include <iostream>
+#include <array>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
 
+#include <boost/asio/dispatch.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
 
 #include "logger.h"
 
@@ -31,6 +41,91 @@ namespace http_server {
                 << LOG::Flush;
         }
     }
+    /*
+     *  Пул памяти полей запросов и ответов на весь сервер. Освобождённые блоки возвращаются в пул и достаются
+     *  следующим сообщениям, поэтому заголовки на поддерживаемых соединениях не ходят в malloc.
+     *  Пул общий, а не на соединение: запрос уходит обработчику в другой strand и может пережить чтение следующего,
+     *  а ответ строится в strand-е обработчика и освобождается в strand-е соединения.
+     */
+    std::pmr::memory_resource* FieldsPool();
+
+    /// Аллокатор полей сообщения (заголовки, target, reason): вся память - из FieldsPool
+    template <typename T>
+    struct PooledAllocator {
+        using value_type = T;
+
+        PooledAllocator() noexcept = default;
+        template <typename U>
+        PooledAllocator(const PooledAllocator<U>&) noexcept {
+        }
+
+        T* allocate(std::size_t n) {
+            return static_cast<T*>(FieldsPool()->allocate(n * sizeof(T), alignof(T)));
+        }
+        void deallocate(T* ptr, std::size_t n) noexcept {
+            FieldsPool()->deallocate(ptr, n * sizeof(T), alignof(T));
+        }
+
+        template <typename U>
+        bool operator==(const PooledAllocator<U>&) const noexcept {
+            return true;
+        }
+    };
+
+    using PooledFields = http::basic_fields<PooledAllocator<char>>;
+    using HttpRequest = http::request<http::string_body, PooledFields>;
+
+    /*
+     *  Место под ответ, ожидающий записи в соединение. Места - у соединения, по одному на запрос в обработке,
+     *  поэтому ответы не выделяются в куче.
+     */
+    class ResponseSlot {
+    public:
+        /// с запасом под http::response с file_body - самым большим из ответов сервера
+        constexpr static std::size_t capacity = 512;
+
+        ResponseSlot() = default;
+        ResponseSlot(const ResponseSlot&) = delete;
+        ResponseSlot& operator=(const ResponseSlot&) = delete;
+        ~ResponseSlot() {
+            Reset();
+        }
+
+        template <typename Response>
+        Response& Emplace(Response&& response) {
+            using Stored = std::decay_t<Response>;
+            static_assert(sizeof(Stored) <= capacity && alignof(Stored) <= alignof(std::max_align_t),
+                          "response does not fit ResponseSlot: increase capacity");
+            Reset();
+            auto* stored = ::new (static_cast<void*>(storage_)) Stored(std::forward<Response>(response));
+            destroy_ = [](void* ptr) noexcept {
+                std::launder(static_cast<Stored*>(ptr))->~Stored();
+            };
+            return *stored;
+        }
+
+        void Reset() noexcept {
+            if (destroy_ != nullptr) {
+                std::exchange(destroy_, nullptr)(storage_);
+            }
+        }
+
+    private:
+        alignas(std::max_align_t) std::byte storage_[capacity];
+        void (*destroy_)(void*) noexcept = nullptr;
+    };
+
+    /// Получает соединение целиком вместе с запросом на переход на WebSocket (Upgrade)
+    using UpgradeHandler = std::function<void(beast::tcp_stream&& stream, HttpRequest&& request)>;
+    using UpgradeHandlerPtr = std::shared_ptr<const UpgradeHandler>;
+
+    /*
+     *  HTTP/1.1 с конвейером (pipelining): следующий запрос читается и уходит обработчику, не дожидаясь ответа
+     *  на предыдущий. Ответы приходят из разных strand-ов в любом порядке, а уходят клиенту строго в порядке запросов:
+     *  у каждого запроса номер, ответ ждёт в своём месте очереди, пока не записаны ответы на все запросы до него.
+     *  В обработке не больше max_in_flight запросов, дальше чтение ждёт записи ответа.
+     *  Всё состояние соединения меняется только в executor-е stream_.
+     */
     class SessionBase {
     public:
         // Запрещаем копирование и присваивание объектов SessionBase и его наследников
@@ -38,60 +133,121 @@ namespace http_server {
         SessionBase& operator=(const SessionBase&) = delete;
         void Run();
 
+        constexpr static std::size_t max_in_flight = 8;
+
     protected:
-        using HttpRequest = http::request<http::string_body>;
-        explicit SessionBase(tcp::socket&& socket);
+        explicit SessionBase(tcp::socket&& socket, UpgradeHandlerPtr upgrade_handler);
 
+        /// Ответ на запрос номер request_index. Можно вызывать из любого потока
         template <typename Body, typename Fields>
-        void Write(http::response<Body, Fields>&& response) {
-            // Запись выполняется асинхронно, поэтому response перемещаем в область кучи
-            auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
-            auto self = GetSharedThis();
-            http::async_write(stream_, *safe_response,
-                [safe_response, self,this](beast::error_code ec, std::size_t bytes_written) {
-                    self->OnWrite(safe_response->need_eof(), ec, bytes_written);
+        void Write(std::uint64_t request_index, http::response<Body, Fields>&& response) {
+            net::dispatch(stream_.get_executor(),
+                [self = GetSharedThis(), request_index, response = std::move(response)]() mutable {
+                    self->Store(request_index, std::move(response));
                 });
         }
 
-
     private:
+        /// Ответ, ожидающий своей очереди на запись
+        struct PendingResponse {
+            ResponseSlot slot;
+            /// ответ в slot; nullptr - ответ ещё не готов
+            void* response = nullptr;
+            /// начинает асинхронную запись response, тип которого знает только Store
+            void (*write)(SessionBase& session, void* response) = nullptr;
+            bool close = false;
+        };
+
+        template <typename Response>
+        void Store(std::uint64_t request_index, Response&& response) {
+            using Stored = std::decay_t<Response>;
+            auto& pending = pending_[request_index % max_in_flight];
+            if (request_index < next_write_ || pending.response != nullptr) {
+                // на запрос уже ответили: обработчик упал после send, и ответ 500 пришёл вторым
+                return;
+            }
+            auto& stored = pending.slot.Emplace(std::forward<Response>(response));
+            pending.response = &stored;
+            pending.close = stored.need_eof();
+            pending.write = [](SessionBase& session, void* ptr) {
+                http::async_write(session.stream_, *static_cast<Stored*>(ptr),
+                    beast::bind_front_handler(&SessionBase::OnWrite, session.GetSharedThis()));
+            };
+            WriteNext();
+        }
+
         void Read();
         void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read);
-        void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
+        /// Пишет ответ на самый ранний запрос без ответа, если он готов и запись не идёт
+        void WriteNext();
+        void OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
+        /// Передаёт соединение WebSocket-у, когда ответы на все запросы до Upgrade записаны
+        void Upgrade();
         void Close();
 
+        std::size_t InFlight() const noexcept {
+            return static_cast<std::size_t>(next_request_ - next_write_);
+        }
+
         virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
         // Обработку запроса делегируем подклассу
-        virtual void HandleRequest(HttpRequest&& request, const tcp::endpoint& remote_endpoint) = 0;
+        virtual void HandleRequest(HttpRequest&& request, const tcp::endpoint& remote_endpoint, std::uint64_t request_index) = 0;
 
     private:
         // tcp_stream содержит внутри себя сокет и добавляет поддержку таймаутов
         beast::tcp_stream stream_;
         beast::flat_buffer buffer_;
         HttpRequest request_;
+        /// индекс - номер запроса по модулю max_in_flight
+        std::array<PendingResponse, max_in_flight> pending_;
+        /// номер следующего прочитанного запроса и номер запроса, чей ответ пишется следующим
+        std::uint64_t next_request_ = 0;
+        std::uint64_t next_write_ = 0;
+        bool reading_ = false;
+        bool writing_ = false;
+        /// новых запросов не будет: клиент закрыл свою сторону, ошибка чтения или запрос без keep-alive
+        bool read_done_ = false;
+        /// request_ - запрос Upgrade, он ждёт ответов на запросы перед ним
+        bool upgrade_waiting_ = false;
+        /// отправка закрыта: ответы, пришедшие после этого, не пишутся
+        bool closed_ = false;
+        /// адрес клиента узнаётся один раз при подключении, а не системным вызовом на каждый запрос
+        tcp::endpoint remote_endpoint_;
+        /// nullptr - сервер не принимает WebSocket, Upgrade обрабатывается как обычный запрос
+        UpgradeHandlerPtr upgrade_handler_;
     };
 
     template <typename RequestHandler>
     class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler>> {
     public:
         template <typename Handler>
-        Session(tcp::socket&& socket, Handler&& request_handler)
-            : SessionBase(std::move(socket))
+        Session(tcp::socket&& socket, Handler&& request_handler, UpgradeHandlerPtr upgrade_handler)
+            : SessionBase(std::move(socket), std::move(upgrade_handler))
             , request_handler_(std::forward<Handler>(request_handler)) {
         }
     private:
         std::shared_ptr<SessionBase> GetSharedThis() override {
             return this->shared_from_this();
         }
-        void HandleRequest(HttpRequest&& request, const tcp::endpoint& remote_endpoint) override {
-            {
+        void HandleRequest(HttpRequest&& request, const tcp::endpoint& remote_endpoint, std::uint64_t request_index) override {
+            const auto version = request.version();
+            const bool keep_alive = request.keep_alive();
+            try {
                 // Захватываем умный указатель на текущий объект Session в лямбде,
                 // чтобы продлить время жизни сессии до вызова лямбды.
                 // Используется generic-лямбда функция, способная принять response произвольного типа
-                request_handler_(std::move(request), remote_endpoint, [self = this->shared_from_this()](auto&& response) {
-                    self->Write(std::move(response));
+                request_handler_(std::move(request), remote_endpoint, [self = this->shared_from_this(), request_index](auto&& response) {
+                    self->Write(request_index, std::move(response));
                     });
             }
+            catch (const std::exception& ex) {
+                // без ответа на этот запрос встали бы ответы на все следующие за ним в конвейере
+                LOG(LOG::ERROR_) << "request handler failed: "sv << ex.what() << LOG::Flush;
+                http::response<http::string_body, PooledFields> response{ http::status::internal_server_error, version };
+                response.keep_alive(keep_alive);
+                response.prepare_payload();
+                Write(request_index, std::move(response));
+            }
         };
 
     private:
@@ -102,10 +258,11 @@ namespace http_server {
     class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
     public:
         template <typename Handler>
-        Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler) : ioc_(ioc)
+        Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler, UpgradeHandlerPtr upgrade_handler) : ioc_(ioc)
             // Обработчики асинхронных операций acceptor_ будут вызываться в своём strand
             , acceptor_(net::make_strand(ioc))
-            , request_handler_(std::forward<Handler>(request_handler)) {
+            , request_handler_(std::forward<Handler>(request_handler))
+            , upgrade_handler_(std::move(upgrade_handler)) {
             // Открываем acceptor, используя протокол (IPv4 или IPv6), указанный в endpoint
             acceptor_.open(endpoint.protocol());
 
@@ -153,21 +310,24 @@ namespace http_server {
             DoAccept();
         };
         void AsyncRunSession(tcp::socket&& socket) {
-            auto session = std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_);
+            auto session = std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_, upgrade_handler_);
             session->Run();
         };
 
         net::io_context& ioc_;
         tcp::acceptor acceptor_;
         RequestHandler request_handler_;
+        UpgradeHandlerPtr upgrade_handler_;
     };
 
     template <typename RequestHandler>
-    void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
+    void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler,
+                   UpgradeHandler upgrade_handler = {}) {
         // При помощи decay_t исключим ссылки из типа RequestHandler,
         // чтобы Listener хранил RequestHandler по значению
         using MyListener = Listener<std::decay_t<RequestHandler>>;
-        std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
+        UpgradeHandlerPtr upgrade = upgrade_handler ? std::make_shared<const UpgradeHandler>(std::move(upgrade_handler)) : nullptr;
+        std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler), std::move(upgrade))->Run();
     }
 
 }  // namespace http_server
@@ -0,0 +1,66 @@
+#include "interned_string.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace util {
+
+namespace {
+
+struct Pool {
+    std::mutex mutex;
+    // ключ смотрит в саму строку из пула, она живёт, пока есть хоть одна ссылка
+    std::unordered_map<std::string_view, std::weak_ptr<const std::string>> entries;
+};
+
+Pool& GetPool() {
+    // не разрушаем при выходе: строки могут освобождаться из деструкторов других статиков
+    static Pool* pool = new Pool;
+    return *pool;
+}
+
+void Release(const std::string* str) {
+    auto& pool = GetPool();
+    {
+        std::lock_guard lock{ pool.mutex };
+        auto it = pool.entries.find(*str);
+        // запись могла уже смениться на новую копию той же строки
+        if (it != pool.entries.end() && it->first.data() == str->data()) {
+            pool.entries.erase(it);
+        }
+    }
+    delete str;
+}
+
+std::shared_ptr<const std::string> Intern(std::string_view str) {
+    auto& pool = GetPool();
+    std::lock_guard lock{ pool.mutex };
+    if (auto it = pool.entries.find(str); it != pool.entries.end()) {
+        if (auto existing = it->second.lock()) {
+            return existing;
+        }
+        // последняя ссылка уже ушла, а Release ещё не успел убрать запись
+        pool.entries.erase(it);
+    }
+    std::shared_ptr<const std::string> interned(new std::string(str), Release);
+    pool.entries.emplace(*interned, interned);
+    return interned;
+}
+
+}  // namespace
+
+InternedString::InternedString()
+    : str_(Intern({})) {
+}
+
+InternedString::InternedString(std::string_view str)
+    : str_(Intern(str)) {
+}
+
+std::size_t InternedString::PoolSize() {
+    auto& pool = GetPool();
+    std::lock_guard lock{ pool.mutex };
+    return pool.entries.size();
+}
+
+}  // namespace util
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace util {
+
+/**
+ * Строка из общего пула.
+ * Одинаковые строки хранятся в пуле один раз, сам объект - указатель со счётчиком ссылок.
+ * Строка уходит из пула вместе с последним ссылающимся на неё объектом,
+ * поэтому имена от клиентов не копятся в памяти после ухода игроков.
+ */
+class InternedString {
+public:
+    InternedString();
+    explicit InternedString(std::string_view str);
+
+    const std::string& operator*() const noexcept {
+        return *str_;
+    }
+
+    const std::string* operator->() const noexcept {
+        return str_.get();
+    }
+
+    bool operator==(const InternedString& rhs) const noexcept {
+        return str_ == rhs.str_;
+    }
+
+    /// число различных строк, живущих сейчас в пуле
+    static std::size_t PoolSize();
+
+private:
+    std::shared_ptr<const std::string> str_;
+};
+
+}  // namespace util
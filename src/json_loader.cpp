@@ -1,8 +1,10 @@
 #include "json_loader.h"
 #include "model.h"
 #include "logger.h"
-#include "extra_data.h"
+#include "json_writer.h"
 
+#include <algorithm>
+#include <charconv>
 #include <fstream>
 #include <iostream>
 
@@ -118,34 +120,29 @@ namespace json_loader {
                 }
                 map_game->SetBagCapacity(bag_capacity);
 
-                game.AddMap(map_game);
-
-                json::array array_of_loots_;
-                try {
-                    array_of_loots_ = map_json.at("lootTypes").as_array();
-                    loot_config.map_id_to_loot_type_count_[map_id] = static_cast<int>(array_of_loots_.size());
-                }
-                catch (std::exception&) {
-                    loot_config.map_id_to_loot_type_count_[map_id] = 0;
-                }
-
-                if (array_of_loots_.size() != 0) {
-                    std::string extra_data_tag = ExtraData::NameHelper({ *map_id,"lootTypes"s });
-                    int loot_type_index = 0;
-                    for (auto& loot_type_jv : array_of_loots_) {
-                        int value;
+                if (auto loot_types = map_json.as_object().if_contains("lootTypes"); loot_types != nullptr && loot_types->is_array()) {
+                    for (const auto& loot_type_jv : loot_types->as_array()) {
+                        LootType loot_type;
                         try {
-                            value = ToInt(loot_type_jv.at("value"));
+                            loot_type.value = ToInt(loot_type_jv.at("value"));
                         }
                         catch (std::exception&) {
-                            value = 0;
+                            loot_type.value = 0;
                         }
-                        loot_config.map_id_to_loot_type_to_scores_[map_id][loot_type_index]=value;
-                        ++loot_type_index;
-
-                        ExtraData::Store(extra_data_tag, json::serialize(loot_type_jv));
+                        if (const auto* loot_obj = loot_type_jv.if_object()) {
+                            if (auto name = loot_obj->if_contains("name"); name != nullptr && name->is_string()) {
+                                loot_type.name = name->as_string();
+                            }
+                            if (auto file = loot_obj->if_contains("file"); file != nullptr && file->is_string()) {
+                                loot_type.file = file->as_string();
+                            }
+                        }
+                        loot_type.json = json::serialize(loot_type_jv);
+                        map_game->AddLootType(std::move(loot_type));
                     }
                 }
+
+                game.AddMap(map_game);
             }
         }
         catch (std::exception& ec) {
@@ -159,46 +156,117 @@ namespace json_loader {
 
     std::string GetMapsList(const Game& game)
     {
-        json::array maps_json;
-        for (auto map : game.GetMaps()) {
-            json::object jo;
-            jo["id"] = *(map->GetId());
-            jo["name"] = map->GetName();
-            maps_json.push_back(jo);
-        }
-        return json::serialize(maps_json);
+        std::string result;
+        util::JsonWriter writer(result);
+        writer.BeginArray();
+        for (const auto& map : game.GetMaps()) {
+            writer.BeginObject()
+                .Key("id"sv).String(*map->GetId())
+                .Key("name"sv).String(map->GetName())
+                .EndObject();
+        }
+        writer.EndArray();
+        return result;
     }
 
-    std::optional<std::string> GetMap(const Game& game, const std::string& map_name)
-    {
-        std::optional<std::string> result(std::nullopt);
+    namespace {
+        std::string SerializeMap(MapSharedPtr map) {
+            std::string result;
+            util::JsonWriter writer(result);
+            writer.BeginObject()
+                .Key("id"sv).String(*map->GetId())
+                .Key("name"sv).String(map->GetName());
+
+            writer.Key("roads"sv).BeginArray();
+            for (const auto& road : map->GetRoads()) {
+                writer.BeginObject()
+                    .Key("x0"sv).Number(road.GetStart().x)
+                    .Key("y0"sv).Number(road.GetStart().y);
+                if (road.IsHorizontal()) {
+                    writer.Key("x1"sv).Number(road.GetEnd().x);
+                }
+                else {
+                    writer.Key("y1"sv).Number(road.GetEnd().y);
+                }
+                writer.EndObject();
+            }
+            writer.EndArray();
+
+            writer.Key("buildings"sv).BeginArray();
+            for (const auto& building : map->GetBuildings()) {
+                const auto& bounds = building.GetBounds();
+                writer.BeginObject()
+                    .Key("x"sv).Number(bounds.position.x)
+                    .Key("y"sv).Number(bounds.position.y)
+                    .Key("w"sv).Number(bounds.size.width)
+                    .Key("h"sv).Number(bounds.size.height)
+                    .EndObject();
+            }
+            writer.EndArray();
+
+            writer.Key("offices"sv).BeginArray();
+            for (const auto& office : map->GetOffices()) {
+                writer.BeginObject()
+                    .Key("id"sv).String(*office.GetId())
+                    .Key("x"sv).Number(office.GetPosition().x)
+                    .Key("y"sv).Number(office.GetPosition().y)
+                    .Key("offsetX"sv).Number(office.GetOffset().dx)
+                    .Key("offsetY"sv).Number(office.GetOffset().dy)
+                    .EndObject();
+            }
+            writer.EndArray();
 
-        for (auto map : game.GetMaps()) {
-            if (*(map->GetId()) == map_name) {
-                json::object jo_map;
-                jo_map["id"] = *(map->GetId());
-                jo_map["name"] = map->GetName();
+            /// типы трофеев уходят клиенту как были в конфиге, со всеми полями для отрисовки
+            writer.Key("lootTypes"sv).BeginArray();
+            for (const auto& loot_type : map->GetLootTypes()) {
+                writer.Raw(loot_type.json);
+            }
+            writer.EndArray();
 
-                jo_map["roads"] = RoadsFromGameToJSON(map);
-                jo_map["buildings"] = BuildingsFromGameToJSON(map);
-                jo_map["offices"] = OfficiesFromGameToJSON(map);
-                jo_map["lootTypes"] = LootTypesFromExtraDataToJSON(*(map->GetId()));
+            writer.EndObject();
+            return result;
+        }
+    }  // namespace
 
-                result = json::serialize(jo_map);
+    MapResponses::MapResponses(const Game& game)
+        : list_(MakeResponse(GetMapsList(game))) {
+        for (const auto& map : game.GetMaps()) {
+            maps_.emplace(*map->GetId(), MakeResponse(SerializeMap(map)));
+        }
+    }
 
-                break;
-            }
+    const MapResponses::Response* MapResponses::Find(std::string_view map_id) const {
+        if (auto it = maps_.find(map_id); it != maps_.end()) {
+            return &it->second;
         }
+        return nullptr;
+    }
 
-        return result;
+    MapResponses::Response MapResponses::MakeResponse(std::string body) {
+        char hash[16];
+        auto hash_end = std::to_chars(hash, hash + sizeof(hash), std::hash<std::string_view>{}(body), 16).ptr;
+        std::string etag = "\"";
+        etag.append(hash, hash_end).append("\"");
+        Response response{ std::make_shared<const std::string>(std::move(body)), std::move(etag), {} };
+        if (response.body->size() >= http_compression::min_size) {
+            for (auto encoding : { http_compression::Encoding::GZIP, http_compression::Encoding::DEFLATE }) {
+                auto compressed = http_compression::Compress(*response.body, encoding, http_compression::level_once);
+                if (compressed.size() < response.body->size()) {
+                    response.encoded[static_cast<std::size_t>(encoding)] = std::make_shared<const std::string>(std::move(compressed));
+                }
+            }
+        }
+        return response;
     }
 
     std::string MakeError(const std::string& code, const std::string& message)
     {
-        json::object jo;
-        jo["code"] = code;
-        jo["message"] = message;
-        return  json::serialize(jo);
+        std::string result;
+        util::JsonWriter(result).BeginObject()
+            .Key("code"sv).String(code)
+            .Key("message"sv).String(message)
+            .EndObject();
+        return result;
     }
 
     int ToInt(const json::value& value) {
@@ -292,193 +360,332 @@ namespace json_loader {
         }
     }
 
-    json::array RoadsFromGameToJSON(MapSharedPtr map)
-    {
-        json::array roads;
-        for (auto const& road : map->GetRoads()) {
-            json::object jo;
-            jo["x0"] = road.GetStart().x;
-            jo["y0"] = road.GetStart().y;
-            if (road.IsHorizontal()) {
-                jo["x1"] = road.GetEnd().x;
-            }
-            else {
-                jo["y1"] = road.GetEnd().y;
+    namespace {
+        /// Строка - как есть, остальные значения - текстом JSON без кавычек
+        std::string ValueToString(const json::value& value) {
+            if (value.is_string()) {
+                return std::string(value.as_string());
             }
-            roads.push_back(jo);
+            auto result = json::serialize(value);
+            boost::erase_all(result, "\"");
+            return result;
         }
-        return roads;
-    }  // namespace json_loader
 
-    json::array BuildingsFromGameToJSON(MapSharedPtr map)
-    {
-        json::array buildings;
-        for (auto const& building : map->GetBuildings()) {
-            json::object jo;
-            jo["x"] = building.GetBounds().position.x;
-            jo["y"] = building.GetBounds().position.y;
-            jo["w"] = building.GetBounds().size.width;
-            jo["h"] = building.GetBounds().size.height;
-            buildings.push_back(jo);
-        }
-        return buildings;
-    }
-
-    json::array OfficiesFromGameToJSON(MapSharedPtr map)
-    {
-        json::array offices;
-        for (auto const& office : map->GetOffices()) {
-            json::object jo;
-            jo["id"] = *office.GetId();
-            jo["x"] = office.GetPosition().x;
-            jo["y"] = office.GetPosition().y;
-            jo["offsetX"] = office.GetOffset().dx;
-            jo["offsetY"] = office.GetOffset().dy;
-            offices.push_back(jo);
-        }
-        return offices;
-    }
-
-    json::array LootTypesFromExtraDataToJSON(const std::string& map_name)
-    {
-        json::array loot_types;
-        std::string extra_data_tag = ExtraData::NameHelper({ map_name, "lootTypes"s });
-        for (auto& loot_type : ExtraData::ReadAll(extra_data_tag)) {
-            loot_types.push_back(json::parse(loot_type));
+        std::optional<BatchActions> ValueToBatchActions(const json::object& obj) {
+            auto actions = obj.if_contains("actions");
+            if (actions == nullptr || !actions->is_array()) {
+                return std::nullopt;
+            }
+            BatchActions result;
+            if (auto with_state = obj.if_contains("withState"); with_state != nullptr) {
+                if (!with_state->is_bool()) {
+                    return std::nullopt;
+                }
+                result.with_state = with_state->as_bool();
+            }
+            result.actions.reserve(actions->as_array().size());
+            for (const auto& action : actions->as_array()) {
+                auto token = action.is_object() ? action.as_object().if_contains("token") : nullptr;
+                auto move = action.is_object() ? action.as_object().if_contains("move") : nullptr;
+                if (token == nullptr || move == nullptr || !token->is_string() || !move->is_string()) {
+                    return std::nullopt;
+                }
+                result.actions.push_back(BatchAction{ std::string(token->as_string()), std::string(move->as_string()) });
+            }
+            return result;
         }
-        
-        return loot_types;
-    }
-    
-    std::string GetValueAsString(const std::string& str, const std::string& key) {
-        json::error_code ec;
-        json::value jv = json::parse(str, ec);
 
-        if (ec) {
-            return "";
+        std::optional<std::vector<std::string>> ValueToStrings(const json::value& value) {
+            if (!value.is_array()) {
+                return std::nullopt;
+            }
+            std::vector<std::string> result;
+            result.reserve(value.as_array().size());
+            for (const auto& item : value.as_array()) {
+                if (!item.is_string()) {
+                    return std::nullopt;
+                }
+                result.emplace_back(item.as_string());
+            }
+            return result;
         }
+    }  // namespace
 
-        if (jv.as_object().contains(key) == false) {
-            return "";
-        }
-        try {
-            auto result = json::serialize(jv.at(key));
-            boost::erase_all(result, "\"");
+    RequestBody ParseRequestBody(std::string_view body) {
+        RequestBody result;
+        if (body.empty()) {
             return result;
-        }catch(std::exception&){
-            return "";
         }
-    }
-
-    std::optional<std::uint64_t> GetValueAsUInt64(const std::string& str, const std::string& key) {
+        unsigned char buffer[4096];
+        json::monotonic_resource resource(buffer);
         json::error_code ec;
-        json::value jv = json::parse(str, ec);
-
+        json::value jv = json::parse(body, ec, &resource);
         if (ec) {
-            return std::nullopt;
-        }
-
-        if (jv.as_object().contains(key) == false) {
-            return std::nullopt;
+            return result;
         }
-        try {
-            std::uint64_t result = jv.at(key).as_int64();
+        result.is_json = true;
+        if (!jv.is_object()) {
             return result;
         }
-        catch (std::exception&) {
+        const auto& obj = jv.as_object();
+        auto string_field = [&obj](std::string_view key) -> std::optional<std::string> {
+            if (auto value = obj.if_contains(key)) {
+                return ValueToString(*value);
+            }
             return std::nullopt;
+        };
+        result.user_name = string_field("userName"sv);
+        result.map_id = string_field("mapId"sv);
+        result.move = string_field("move"sv);
+        result.authorization = string_field("authorization"sv);
+        if (result.authorization == std::nullopt) {
+            result.authorization = string_field("Authorization"sv);
+        }
+        if (auto time_delta = obj.if_contains("timeDelta")) {
+            result.has_time_delta = true;
+            if (auto value = time_delta->if_int64(); value != nullptr && *value >= 0) {
+                result.time_delta = static_cast<std::uint64_t>(*value);
+            }
+        }
+        if (obj.contains("actions")) {
+            result.batch_actions = ValueToBatchActions(obj);
+        }
+        if (auto user_names = obj.if_contains("userNames")) {
+            result.user_names = ValueToStrings(*user_names);
         }
+        return result;
     }
 
-    bool isJsonValid(const std::string& str) {
-        json::error_code ec;
-        json::value jv = json::parse(str, ec);
-        if (ec) {
-            return false;
+    std::string GetPlayersCase(const model::SessionSnapshot& snapshot) {
+        /// игроки по возрастанию id, как раньше отдавал std::map
+        std::vector<const model::SessionSnapshot::DogState*> dogs;
+        dogs.reserve(snapshot.dogs.size());
+        for (const auto& dog : snapshot.dogs) {
+            dogs.push_back(&dog);
         }
-        return true;
+        std::sort(dogs.begin(), dogs.end(), [](const auto* lhs, const auto* rhs) {
+            return lhs->player_id < rhs->player_id;
+        });
+
+        std::string result;
+        result.reserve(dogs.size() * 32 + 2);
+        util::JsonWriter writer(result);
+        writer.BeginObject();
+        for (const auto* dog : dogs) {
+            writer.NumberKey(dog->player_id).BeginObject()
+                .Key("name"sv).String(*dog->name)
+                .EndObject();
+        }
+        writer.EndObject();
+        return result;
     }
-    std::string GetPlayersCase(const std::vector<app::PlayerSharedPtr> & players) {
-        json::object arr;
 
-        std::map<uint64_t, std::string> result_map;
-        for (auto& p : players) {
-            result_map[p.get()->GetIdAsUInt64()] = p.get()->GetName();
+    namespace {
+        /// Примерный размер в JSON, чтобы строка ответа выделялась один раз
+        constexpr std::size_t dog_json_size = 160;
+        constexpr std::size_t loot_json_size = 64;
+
+        void WritePair(util::JsonWriter& writer, double left, double right) {
+            writer.BeginArray().Number(left).Number(right).EndArray();
+        }
+
+        void WriteDogState(util::JsonWriter& writer, const model::SessionSnapshot::DogState& dog) {
+            writer.NumberKey(dog.player_id).BeginObject();
+            writer.Key("pos"sv);
+            WritePair(writer, dog.position.x, dog.position.y);
+            writer.Key("speed"sv);
+            WritePair(writer, dog.speed.dx, dog.speed.dy);
+            writer.Key("dir"sv).String(dog.dir);
+            writer.Key("bag"sv).BeginArray();
+            for (const auto& item : dog.bag) {
+                writer.BeginObject()
+                    .Key("id"sv).Number(item.id)
+                    .Key("type"sv).Number(item.type)
+                    .EndObject();
+            }
+            writer.EndArray();
+            writer.Key("score"sv).Number(dog.score);
+            writer.EndObject();
         }
 
-        for (const auto& [key, value] : result_map) {
-            arr.emplace(std::to_string(key), ToJsonAsObject("name", value));
+        void WriteLootState(util::JsonWriter& writer, const model::SessionSnapshot::LootState& l) {
+            writer.NumberKey(l.id).BeginObject();
+            writer.Key("type"sv).Number(l.type);
+            writer.Key("pos"sv);
+            WritePair(writer, l.position.x, l.position.y);
+            writer.EndObject();
         }
 
-        std::string result= json::serialize(arr);
-        boost::replace_all(result, "\\\\", "\\");
-        return result;
-    }
+        /// Поля полного состояния без внешних скобок: к ним GetStateSinceCase дописывает full и tick
+        void WriteState(util::JsonWriter& writer, const model::SessionSnapshot& snapshot) {
+            writer.Key("players"sv).BeginObject();
+            for (const auto& dog : snapshot.dogs) {
+                WriteDogState(writer, dog);
+            }
+            writer.EndObject();
 
-    std::string GetStateCase(const std::vector<app::PlayerSharedPtr>& players, const std::vector<app::LootSharedPtr>& loots) {
-        auto array_pair = []<typename T>(T left, T right) {
-            return json::array{left, right};
-        };
+            writer.Key("lostObjects"sv).BeginObject();
+            for (const auto& l : snapshot.loots) {
+                WriteLootState(writer, l);
+            }
+            writer.EndObject();
+        }
 
-        json::object result;
-        json::object arr_players;
-
-        for (auto& p : players) {
-            json::object player;
-
-            player.emplace("pos", array_pair(p->GetDog()->GetPosition().x, p->GetDog()->GetPosition().y));
-            player.emplace("speed", array_pair(p->GetDog()->GetSpeed().dx, p->GetDog()->GetSpeed().dy));
-            player.emplace("dir", p->GetDog()->GetDirStr());
-            
-            json::array bag;
-            for (auto& loot_id : p->GetDog()->GetLootList()) {
-                json::value loot = {
-                    { "id",loot_id },
-                    { "type",p->GetDog()->GetLoot(loot_id)->GetType()}
-                };
-                bag.push_back(loot);
+        /// Только изменившиеся с прошлого запроса клиента игроки и предметы плюс id исчезнувших
+        void WriteChanges(util::JsonWriter& writer, const model::SessionSnapshot& snapshot, const model::TickChanges& changes) {
+            writer.Key("players"sv).BeginObject();
+            for (auto dog_id : changes.changed_dogs) {
+                /// собака могла появиться и уйти внутри интервала - тогда её нет в снимке
+                if (const auto* dog = snapshot.FindDog(dog_id)) {
+                    WriteDogState(writer, *dog);
+                }
             }
-            player.emplace("bag", bag);
-            player.emplace("score", p->GetDog()->GetScore());
+            writer.EndObject();
 
-            arr_players.emplace(p->GetId(), player);
+            writer.Key("lostObjects"sv).BeginObject();
+            for (auto loot_id : changes.changed_loots) {
+                if (const auto* l = snapshot.FindLoot(loot_id)) {
+                    WriteLootState(writer, *l);
+                }
+            }
+            writer.EndObject();
+
+            /// id исчезнувших - строками, как ключи в players и lostObjects
+            char buffer[24];
+            auto write_ids = [&writer, &buffer](const auto& ids) {
+                writer.BeginArray();
+                for (auto id : ids) {
+                    auto result = std::to_chars(buffer, buffer + sizeof(buffer), id);
+                    writer.String(std::string_view(buffer, result.ptr - buffer));
+                }
+                writer.EndArray();
+            };
+            writer.Key("removedPlayers"sv);
+            write_ids(changes.removed_players);
+            writer.Key("removedLostObjects"sv);
+            write_ids(changes.removed_loots);
         }
-        result.emplace("players", arr_players);
+    }  // namespace
 
-        json::object arr_loots;
-        for (auto& l : loots) {
-            json::object loot;
+    std::string GetStateCase(const model::SessionSnapshot& snapshot) {
+        std::string result;
+        result.reserve(snapshot.dogs.size() * dog_json_size + snapshot.loots.size() * loot_json_size + 64);
+        util::JsonWriter writer(result);
+        writer.BeginObject();
+        WriteState(writer, snapshot);
+        writer.EndObject();
+        return result;
+    }
 
-            loot.emplace("type", l->GetType());
-            loot.emplace("pos", array_pair(l->GetPos().x, l->GetPos().y));
+    std::string GetStateAroundCase(const model::SessionSnapshot& snapshot, model::MapPoint center, model::Double radius) {
+        std::string result;
+        util::JsonWriter writer(result);
+        writer.BeginObject();
+        writer.Key("players"sv).BeginObject();
+        snapshot.dogs_grid.ForEachNear(center.x, center.y, radius, [&](std::size_t i) {
+            WriteDogState(writer, snapshot.dogs[i]);
+        });
+        writer.EndObject();
+
+        writer.Key("lostObjects"sv).BeginObject();
+        snapshot.loots_grid.ForEachNear(center.x, center.y, radius, [&](std::size_t i) {
+            WriteLootState(writer, snapshot.loots[i]);
+        });
+        writer.EndObject();
+        writer.EndObject();
+        return result;
+    }
 
-            arr_loots.emplace(l->GetIdStr(), loot);
+    std::string GetStateSinceCase(const model::SessionSnapshot& snapshot, std::uint64_t since) {
+        std::string result;
+        util::JsonWriter writer(result);
+        writer.BeginObject();
+        if (auto changes = snapshot.ChangesSince(since)) {
+            result.reserve((changes->changed_dogs.size() + changes->removed_players.size()) * dog_json_size +
+                           (changes->changed_loots.size() + changes->removed_loots.size()) * loot_json_size + 128);
+            WriteChanges(writer, snapshot, changes.value());
+            writer.Key("full"sv).Bool(false);
+        }
+        else {
+            result.reserve(snapshot.dogs.size() * dog_json_size + snapshot.loots.size() * loot_json_size + 64);
+            WriteState(writer, snapshot);
+            writer.Key("full"sv).Bool(true);
         }
-        result.emplace("lostObjects", arr_loots);
+        writer.Key("tick"sv).Number(snapshot.tick);
+        writer.EndObject();
+        return result;
+    }
 
+    std::string GetBatchActionsCase(const std::vector<std::string_view>& codes,
+                                    const std::vector<std::pair<std::string_view, model::SessionSnapshot::Body>>& states) {
+        std::string body;
+        util::JsonWriter writer(body);
+        writer.BeginObject().Key("results"sv).BeginArray();
+        for (auto code : codes) {
+            writer.BeginObject();
+            if (!code.empty()) {
+                writer.Key("code"sv).String(code);
+            }
+            writer.EndObject();
+        }
+        writer.EndArray();
+        if (!states.empty()) {
+            writer.Key("states"sv).BeginObject();
+            for (const auto& [map_id, state] : states) {
+                writer.Key(map_id).Raw(*state);
+            }
+            writer.EndObject();
+        }
+        writer.EndObject();
+        return body;
+    }
+
+    std::string GetBulkJoinCase(const std::vector<app::PlayerSharedPtr>& players) {
+        std::string result;
+        result.reserve(players.size() * 80 + 2);
+        util::JsonWriter writer(result);
+        writer.BeginArray();
+        for (const auto& player : players) {
+            writer.BeginObject()
+                .Key("authToken"sv).String(app::TokenToString(player->GetToken()))
+                .Key("playerId"sv).Number(player->GetIdAsUInt64())
+                .EndObject();
+        }
+        writer.EndArray();
+        return result;
+    }
 
-        std::string result_str = json::serialize(result);
-        boost::replace_all(result_str, "\\\\", "\\");
-        return result_str;
+    std::string GetAdmissionCase(const util::AdmissionStats& stats) {
+        std::string result;
+        util::JsonWriter writer(result);
+        writer.BeginObject();
+        for (auto [name, kind] : { std::pair{ "reads"sv, util::RequestKind::READ }, std::pair{ "writes"sv, util::RequestKind::WRITE } }) {
+            writer.Key(name).BeginObject()
+                .Key("queued"sv).Number(stats.queued[static_cast<std::size_t>(kind)])
+                .Key("shed"sv).Number(stats.shed[static_cast<std::size_t>(kind)])
+                .EndObject();
+        }
+        writer.Key("maxLastWaitUs"sv).Number(stats.max_last_wait.count())
+            .EndObject();
+        return result;
     }
+
     std::string GetRecordsCase(Game& game, int start, int maxItems)
     {
         auto pool = game.GetDBConnectionPool();
         auto records = postgres::Database::GetPlayersRecords(pool, start, maxItems);
 
-        json::array ja_records;
-       
+        std::string result;
+        util::JsonWriter writer(result);
+        writer.BeginArray();
         for (auto& [id, name, score, playTime ] : records) {
-            json::value record = {
-                { "name",name },
-                { "score",score },
-                { "playTime",static_cast<double>(playTime)/1000. }
-            };
-            ja_records.push_back(record);
+            writer.BeginObject()
+                .Key("name"sv).String(name)
+                .Key("score"sv).Number(score)
+                .Key("playTime"sv).Number(static_cast<double>(playTime) / 1000.)
+                .EndObject();
         }
-
-        std::string result = json::serialize(ja_records);
-        //boost::replace_all(result, "\\\\", "\\");
+        writer.EndArray();
         return result;
     }
 }//namespace json_loader
\ No newline at end of file
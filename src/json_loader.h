@@ -1,11 +1,16 @@
 ﻿#pragma once
 
+#include <array>
 #include <filesystem>
+#include <map>
 #include <optional>
+#include <string_view>
 
 #include "model.h"
 #include "logger.h"
 #include "application.h"
+#include "http_compression.h"
+#include "admission_control.h"
 
 #include <boost/json.hpp>
 
@@ -22,7 +27,6 @@ namespace json_loader {
 
 model::Game LoadGame(const std::filesystem::path& json_path);
 std::string GetMapsList(const Game & game);
-std::optional<std::string> GetMap(const Game& game, const std::string & map_name );
 std::string MakeError(const std::string& code, const std::string& message);
 
 int ToInt(const json::value& value);
@@ -33,40 +37,95 @@ void RoadsFromJSONToGame(MapSharedPtr new_map, const json::array & roads);
 void BuildingsFromJSONToGame(MapSharedPtr new_map, const json::array& buildings);
 void OfficiesFromJSONToGame(MapSharedPtr new_map, const json::array& offices);
 
-json::array RoadsFromGameToJSON(MapSharedPtr map);
-json::array BuildingsFromGameToJSON(MapSharedPtr map);
-json::array OfficiesFromGameToJSON(MapSharedPtr map);
-
-json::array LootTypesFromExtraDataToJSON(const std::string& map_name);
-
-template<typename... KEYS>
-bool isJsonHaveKeys(const::std::string& str, KEYS&&...keys) {
-	json::error_code ec;
-	json::value jv = json::parse(str,ec);
-	if (ec) {
-		return false;
-	}
-	bool contains = true;
-	([&] { contains &= jv.as_object().contains(keys); }(), ...);
-
-	return contains;
-};
 
 template<GoodJSONType... ARGS>
 static std::string ToJsonAsString(ARGS&&... args){
-    return json::serialize(LOG::ToJson(args...).as_object());
+    return LOG::ToJson(args...).text;
 };
 
-template<GoodJSONType... ARGS>
-static json::object ToJsonAsObject(ARGS&&... args) {
-    return  LOG::ToJson(args...).as_object();
+struct BatchAction {
+    std::string token;
+    std::string move;
+};
+/// Тело POST /player/actions: {"actions": [{"token": "...", "move": "L"}, ...], "withState": true}
+struct BatchActions {
+    std::vector<BatchAction> actions;
+    bool with_state = false;
 };
 
-std::string GetValueAsString(const std::string& str, const std::string& key);
-std::optional<std::uint64_t> GetValueAsUInt64(const std::string& str, const std::string& key);
-bool isJsonValid(const std::string& str);
-std::string GetPlayersCase(const std::vector<app::PlayerSharedPtr>& players);
-std::string GetStateCase(const std::vector<app::PlayerSharedPtr>& players, const std::vector<app::LootSharedPtr>& loots);
+/*
+ * Тело запроса API, разобранное за один проход: RequestHandler разбирает его один раз
+ * и передаёт и в выбор strand-а, и в RequestAPI::process.
+ * std::nullopt в поле - ключа нет, тело не объект JSON или значение не той формы.
+ */
+struct RequestBody {
+    /// тело - корректный JSON
+    bool is_json = false;
+    std::optional<std::string> user_name;
+    std::optional<std::string> map_id;
+    std::optional<std::string> move;
+    /// ключ "authorization" или "Authorization"
+    std::optional<std::string> authorization;
+    bool has_time_delta = false;
+    /// std::nullopt при has_time_delta - не целое число
+    std::optional<std::uint64_t> time_delta;
+    /// /player/actions
+    std::optional<BatchActions> batch_actions;
+    /// /join/bulk
+    std::optional<std::vector<std::string>> user_names;
+};
+/// Разбор в стековом буфере (json::monotonic_resource): в кучу попадают только строки полей результата
+RequestBody ParseRequestBody(std::string_view body);
+std::string GetPlayersCase(const model::SessionSnapshot& snapshot);
+std::string GetStateCase(const model::SessionSnapshot& snapshot);
+/// Ответ /state?sinceTick: изменения после тика since или полное состояние ("full": true), если since вне истории
+std::string GetStateSinceCase(const model::SessionSnapshot& snapshot, std::uint64_t since);
+/// Ответ /state?aoiRadius: только игроки и предметы не дальше radius от center (по сеткам снимка)
+std::string GetStateAroundCase(const model::SessionSnapshot& snapshot, model::MapPoint center, model::Double radius);
 std::string GetRecordsCase(Game& game, int start, int maxItems);
 
+/*
+ * Ответ /player/actions: {"results": [...], "states": {"<mapId>": <тело /state>, ...}}.
+ * results[i] - пустой объект, если действие принято, иначе объект с кодом ошибки codes[i].
+ * Тела состояний берутся из кэша снимков и вставляются как есть, без повторного разбора.
+ */
+std::string GetBatchActionsCase(const std::vector<std::string_view>& codes,
+                                const std::vector<std::pair<std::string_view, model::SessionSnapshot::Body>>& states);
+
+/// Ответ /join/bulk: [{"authToken": ..., "playerId": ...}, ...] в порядке userNames
+std::string GetBulkJoinCase(const std::vector<app::PlayerSharedPtr>& players);
+
+/// Ответ /admission: {"reads": {"queued": ..., "shed": ...}, "writes": {...}, "maxLastWaitUs": ...}
+std::string GetAdmissionCase(const util::AdmissionStats& stats);
+
+/*
+ * Ответы /maps и /maps/{id}. Карты не меняются после LoadGame, поэтому тела строятся один раз при запуске
+ * и дальше отдаются без копирования.
+ * ETag - хеш тела: он не меняется между перезапусками, пока не изменился конфиг карт.
+ * Сжатые представления тоже готовятся при запуске.
+ */
+class MapResponses {
+public:
+    struct Response {
+        model::SessionSnapshot::Body body;
+        std::string etag;
+        /// индекс - http_compression::Encoding; nullptr - сжатие не уменьшает тело или это IDENTITY
+        std::array<model::SessionSnapshot::Body, model::SessionSnapshot::body_encodings> encoded;
+    };
+
+    explicit MapResponses(const Game& game);
+
+    const Response& GetList() const noexcept {
+        return list_;
+    }
+    /// nullptr - карты с таким id нет
+    const Response* Find(std::string_view map_id) const;
+
+private:
+    static Response MakeResponse(std::string body);
+
+    Response list_;
+    std::map<std::string, Response, std::less<>> maps_;
+};
+
 }  // namespace json_loader
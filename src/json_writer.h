@@ -0,0 +1,167 @@
+#pragma once
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace util {
+
+/*
+ *  Потоковая запись JSON прямо в строку, без промежуточного дерева json::value.
+ *  Писатель только дописывает в конец out: после clear() та же строка переиспользуется без новых аллокаций.
+ *  Запятые между элементами расставляются сами, вложенность не проверяется - порядок вызовов на вызывающем.
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) noexcept
+        : out_(out) {
+    }
+
+    JsonWriter& BeginObject() {
+        Separate();
+        out_.push_back('{');
+        need_comma_ = false;
+        return *this;
+    }
+
+    JsonWriter& EndObject() {
+        out_.push_back('}');
+        need_comma_ = true;
+        return *this;
+    }
+
+    JsonWriter& BeginArray() {
+        Separate();
+        out_.push_back('[');
+        need_comma_ = false;
+        return *this;
+    }
+
+    JsonWriter& EndArray() {
+        out_.push_back(']');
+        need_comma_ = true;
+        return *this;
+    }
+
+    JsonWriter& Key(std::string_view key) {
+        Separate();
+        AppendString(key);
+        out_.push_back(':');
+        need_comma_ = false;
+        return *this;
+    }
+
+    /// Ключ-число: id игроков и предметов - ключи объектов в ответах API
+    JsonWriter& NumberKey(std::uint64_t key) {
+        Separate();
+        out_.push_back('"');
+        AppendChars(key);
+        out_.append("\":");
+        need_comma_ = false;
+        return *this;
+    }
+
+    JsonWriter& String(std::string_view value) {
+        Separate();
+        AppendString(value);
+        need_comma_ = true;
+        return *this;
+    }
+
+    template <std::integral T>
+        requires (!std::same_as<T, bool>)
+    JsonWriter& Number(T value) {
+        Separate();
+        AppendChars(value);
+        need_comma_ = true;
+        return *this;
+    }
+
+    /// Кратчайшая запись, которая читается обратно в то же число. NaN и бесконечностей в JSON нет - пишется null
+    JsonWriter& Number(double value) {
+        Separate();
+        if (std::isfinite(value)) {
+            AppendChars(value);
+        }
+        else {
+            out_.append("null");
+        }
+        need_comma_ = true;
+        return *this;
+    }
+
+    JsonWriter& Bool(bool value) {
+        Separate();
+        out_.append(value ? "true" : "false");
+        need_comma_ = true;
+        return *this;
+    }
+
+    JsonWriter& Null() {
+        Separate();
+        out_.append("null");
+        need_comma_ = true;
+        return *this;
+    }
+
+    /// Уже готовый JSON (например, закешированное тело ответа) - как есть
+    JsonWriter& Raw(std::string_view json) {
+        Separate();
+        out_.append(json);
+        need_comma_ = true;
+        return *this;
+    }
+
+private:
+    void Separate() {
+        if (need_comma_) {
+            out_.push_back(',');
+        }
+    }
+
+    template <typename T>
+    void AppendChars(T value) {
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out_.append(buffer, result.ptr);
+    }
+
+    void AppendString(std::string_view str) {
+        static constexpr char hex[] = "0123456789abcdef";
+        out_.push_back('"');
+        /// без экранирования - кусками, а не по символу
+        std::size_t plain_from = 0;
+        for (std::size_t i = 0; i < str.size(); ++i) {
+            const auto ch = static_cast<unsigned char>(str[i]);
+            if (ch >= 0x20 && ch != '"' && ch != '\\') {
+                continue;
+            }
+            out_.append(str.data() + plain_from, i - plain_from);
+            plain_from = i + 1;
+            switch (ch) {
+            case '"': out_.append("\\\""); break;
+            case '\\': out_.append("\\\\"); break;
+            case '\b': out_.append("\\b"); break;
+            case '\f': out_.append("\\f"); break;
+            case '\n': out_.append("\\n"); break;
+            case '\r': out_.append("\\r"); break;
+            case '\t': out_.append("\\t"); break;
+            default:
+                out_.append("\\u00");
+                out_.push_back(hex[ch >> 4]);
+                out_.push_back(hex[ch & 0xf]);
+            }
+        }
+        out_.append(str.data() + plain_from, str.size() - plain_from);
+        out_.push_back('"');
+    }
+
+    std::string& out_;
+    /// перед следующим значением или ключом нужна запятая
+    bool need_comma_ = false;
+};
+
+}  // namespace util
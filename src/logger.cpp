@@ -37,7 +37,7 @@ namespace logger {
 
     LOG& LOG::operator<<(std::string msg) {
         if (severity == LOG::MESSAGE_DATA) {
-            map_to_send["message"] = msg;
+            message_to_send = msg;
         }
         else {
             str_to_send.append(msg);
@@ -46,7 +46,7 @@ namespace logger {
     };
     LOG& LOG::operator<<(std::string_view msg) {
         if (severity == LOG::MESSAGE_DATA) {
-            map_to_send["message"] = std::string(msg);
+            message_to_send = std::string(msg);
         }
         else {
             str_to_send.append(msg);
@@ -55,7 +55,7 @@ namespace logger {
     };
     LOG& LOG::operator<<(const char* msg) {
         if (severity == LOG::MESSAGE_DATA) {
-            map_to_send["message"] = std::string(msg);
+            message_to_send = std::string(msg);
         }
         else {
             str_to_send.append(msg);
@@ -64,21 +64,19 @@ namespace logger {
     };
     LOG& LOG::operator<<(const int& msg) {
         if (severity == LOG::MESSAGE_DATA) {
-            map_to_send["message"] = std::to_string(msg);
+            message_to_send = std::to_string(msg);
         }
         else {
             str_to_send.append(std::to_string(msg));
         }
         return *this;
     }
-    LOG& LOG::operator<<(json::value&& msg) {
+    LOG& LOG::operator<<(JsonText&& msg) {
         if (severity == LOG::MESSAGE_DATA) {
-            map_to_send["data"] = msg;
+            data_to_send = std::move(msg.text);
         }
         else {
-            std::stringstream ss;
-            ss << msg;
-            str_to_send.append(ss.str());
+            str_to_send.append(msg.text);
         }
         return *this;
     };
@@ -101,14 +99,13 @@ namespace logger {
             case LOG::FATAL:
             {
                 if (data_type == JSON) {
-
-                    json::object jv_full_msg;
-                    jv_full_msg.emplace("timestamp", boost::posix_time::to_iso_extended_string(boost::posix_time::microsec_clock::universal_time()));
-                    jv_full_msg.emplace("data", str_to_send);
-                    jv_full_msg.emplace("message", severity_strings[static_cast<int>(severity)]);
-                    std::stringstream ss;
-                    ss << jv_full_msg;
-                    BOOST_LOG(my_logger::get()) << ss.str();
+                    std::string full_msg;
+                    util::JsonWriter(full_msg).BeginObject()
+                        .Key("timestamp").String(boost::posix_time::to_iso_extended_string(boost::posix_time::microsec_clock::universal_time()))
+                        .Key("data").String(str_to_send)
+                        .Key("message").String(severity_strings[static_cast<int>(severity)])
+                        .EndObject();
+                    BOOST_LOG(my_logger::get()) << full_msg;
                 }
                 else {
                     BOOST_LOG(my_logger::get()) << str_to_send;
@@ -122,13 +119,16 @@ namespace logger {
                 }
             case LOG::MESSAGE_DATA:
             {
-                json::object jv_full_msg;
-                jv_full_msg.emplace("timestamp", boost::posix_time::to_iso_extended_string(boost::posix_time::microsec_clock::universal_time()));
-                jv_full_msg.emplace("data", map_to_send["data"]);
-                jv_full_msg.emplace("message", map_to_send["message"]);
-                std::stringstream ss;
-                ss << jv_full_msg;
-                BOOST_LOG(my_logger::get()) << ss.str();
+                std::string full_msg;
+                util::JsonWriter writer(full_msg);
+                writer.BeginObject()
+                    .Key("timestamp").String(boost::posix_time::to_iso_extended_string(boost::posix_time::microsec_clock::universal_time()));
+                writer.Key("data");
+                data_to_send ? writer.Raw(*data_to_send) : writer.Null();
+                writer.Key("message");
+                message_to_send ? writer.String(*message_to_send) : writer.Null();
+                writer.EndObject();
+                BOOST_LOG(my_logger::get()) << full_msg;
             }
             break;
             }
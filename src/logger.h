@@ -19,6 +19,8 @@
 
 #include <boost/json.hpp>
 
+#include "json_writer.h"
+
 namespace json = boost::json;
 namespace sys = boost::system;
 namespace logging = boost::log;
@@ -79,41 +81,50 @@ namespace logger{
         LOG(MESSAGE_SEVERITY sev, DATA_TYPE type);
         static void Init();
 
+        /// Готовый текст JSON для поля data сообщения
+        struct JsonText {
+            std::string text;
+        };
+
+        /// ToJson("key1", value1, "key2", value2, ...) -> {"key1":value1,"key2":value2,...}
         template<GoodJSONType... ARGS>
-        static json::value ToJson(ARGS&&... args) {
+        static JsonText ToJson(ARGS&&... args) {
             static_assert(sizeof...(ARGS) % 2 == 0, "ERROR:the number of arguments must be divided by two ");
-            json::object arr;
-            using VariantLog = std::variant<std::string, uint64_t>;
-            std::vector<VariantLog> vec;
-            ([&vec, &args] {
-                if constexpr (StringConvertible<decltype(args)>) {
-                    vec.push_back(std::string(args));
-                }
-                else if constexpr (IntConvertible<decltype(args)>) {
-                    vec.push_back(static_cast<uint64_t>(args));
-                }
-                }(), ...);
-            for (int i = 0; i < vec.size(); i += 2) {
-                std::string key = std::get<std::string>(vec[i]);
-                if (std::holds_alternative< std::string >(vec[i + 1])) {
-                    arr.emplace(key, std::get<std::string>(vec[i + 1]));
+            JsonText result;
+            util::JsonWriter writer(result.text);
+            writer.BeginObject();
+            bool is_key = true;
+            ([&writer, &is_key](auto&& arg) {
+                using Arg = decltype(arg);
+                if constexpr (StringConvertible<Arg>) {
+                    if constexpr (std::is_convertible_v<Arg, std::string_view>) {
+                        is_key ? writer.Key(arg) : writer.String(arg);
+                    }
+                    else {
+                        const std::string str(arg);
+                        is_key ? writer.Key(str) : writer.String(str);
+                    }
                 }
-                else if (std::holds_alternative < uint64_t >(vec[i + 1])) {
-                    arr.emplace(key, std::get<uint64_t>(vec[i + 1]));
+                else if constexpr (IntConvertible<Arg>) {
+                    writer.Number(static_cast<uint64_t>(arg));
                 }
-            }
-            return json::value(arr);
+                is_key = !is_key;
+            }(std::forward<ARGS>(args)), ...);
+            writer.EndObject();
+            return result;
         };
 
         LOG& operator<<(std::string msg) ;
         LOG& operator<<(std::string_view msg) ;
         LOG& operator<<(const char* msg) ;
         LOG& operator<<(const int& msg);
-        LOG& operator<<(json::value&& msg);
+        LOG& operator<<(JsonText&& msg);
         LOG& operator<<(SERVICE msg);
 
     private:
-        std::map<std::string, json::value> map_to_send;
+        /// поля сообщения MESSAGE_DATA: пока их не задали, в JSON пишется null
+        std::optional<std::string> message_to_send;
+        std::optional<std::string> data_to_send;
         std::string str_to_send;
         static bool is_init;
         MESSAGE_SEVERITY severity;
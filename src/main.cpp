@@ -12,6 +12,7 @@
 
 #include "json_loader.h"
 #include "request_handler.h"
+#include "game_websocket.h"
 #include "response_utils.h"
 #include "logger.h"
 #include "ticker.h"
@@ -63,6 +64,12 @@ struct Args {
     std::string state_file_path;
     int save_state_period;
     bool randomize_spawn_points;
+    /// пороги admission control, 0 - без ограничения
+    std::size_t max_queued_reads = 0;
+    std::size_t max_queued_writes = 0;
+    int max_read_wait = 0;
+    int max_write_wait = 0;
+    int retry_after = 1;
 };
 
 [[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
@@ -75,7 +82,12 @@ struct Args {
         ("www-root,w", po::value(&args.www_root_path), "Static www files path")
         ("randomize-spawn-points", "Spawn dogs in random map point")
         ("state-file,s", po::value(&args.state_file_path), "State file path")
-        ("save-state-period,p", po::value<int>(&args.save_state_period), "Auto save period in ms");
+        ("save-state-period,p", po::value<int>(&args.save_state_period), "Auto save period in ms")
+        ("max-queued-reads", po::value(&args.max_queued_reads), "API reads allowed to wait in one strand queue before 503, 0 - unlimited")
+        ("max-queued-writes", po::value(&args.max_queued_writes), "API writes allowed to wait in one strand queue before 503, 0 - unlimited")
+        ("max-read-wait", po::value<int>(&args.max_read_wait), "Queue wait in ms after which API reads get 503, 0 - unlimited")
+        ("max-write-wait", po::value<int>(&args.max_write_wait), "Queue wait in ms after which API writes get 503, 0 - unlimited")
+        ("retry-after", po::value<int>(&args.retry_after), "Retry-After of 503 responses in seconds");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -155,6 +167,14 @@ int main(int argc, const char* argv[]) {
                 return EXIT_FAILURE;
             }
         }
+        for (const auto& [name, size_of, count] : game.GetMemoryReport()) {
+            LOG(LOG::MESSAGE_DATA) << "memory footprint"sv
+                                   << LOG::ToJson("entity"sv, name,
+                                                  "sizeof"sv, size_of,
+                                                  "count"sv, count,
+                                                  "bytes"sv, size_of * count)
+                                   << LOG::Flush;
+        }
         game.SetTickPeriod(args.tick_period);
         game.SetRandomizeSpawnPoint(args.randomize_spawn_points);
         http_handler::FileManager::SetRootPath(args.www_root_path);
@@ -204,15 +224,31 @@ int main(int argc, const char* argv[]) {
             });
 
         // 4. Создаём обработчик HTTP-запросов и связываем его с моделью игры
-        //http_handler::RequestHandler handler{game, ticker_strand};
-        auto api_strand = net::make_strand(ioc);
-        auto handler = std::make_shared<http_handler::RequestHandler>(game, api_strand);
+        util::AdmissionLimits admission_limits;
+        admission_limits.reads = { args.max_queued_reads, krn::milliseconds(args.max_read_wait) };
+        admission_limits.writes = { args.max_queued_writes, krn::milliseconds(args.max_write_wait) };
+        admission_limits.retry_after = krn::seconds(std::max(0, args.retry_after));
+        auto handler = std::make_shared<http_handler::RequestHandler>(game, ioc, admission_limits);
+
+        // 4.5 После каждого тика состояние рассылается подписчикам WebSocket
+        auto push_hub = std::make_shared<http_handler::StatePushHub>();
+        game.SetTickObserver([push_hub] {
+            push_hub->Broadcast();
+        });
+        auto ws_context = std::make_shared<const http_handler::GameWebSocket::Context>(http_handler::GameWebSocket::Context{
+            game,
+            push_hub,
+            [handler](model::Game::Command command) {
+                handler->SubmitCommand(std::move(command));
+            } });
 
         // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
         const auto address = net::ip::make_address("0.0.0.0");
         constexpr net::ip::port_type port = 8080;
         http_server::ServeHttp(ioc, {address, port}, [&handler](auto&& req, const auto& remote_endpoint, auto&& send) {
             (*handler)(std::forward<decltype(req)>(req), remote_endpoint, std::forward<decltype(send)>(send));
+        }, [ws_context](boost::beast::tcp_stream&& stream, http_server::HttpRequest&& req) {
+            http_handler::GameWebSocket::Accept(std::move(stream), std::move(req), ws_context);
         });
         
         // Эта надпись сообщает тестам о том, что сервер запущен и готов обрабатывать запросы
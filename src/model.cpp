@@ -1,6 +1,7 @@
 #include "model.h"
 #include "loot_generator.h"
 
+#include <algorithm>
 #include <random>
 #include <stdexcept>
 #include <map>
@@ -93,6 +94,10 @@ const Map::Roads& Map::GetRoads() const noexcept {
     return roads_;
 }
 
+const Map::LootTypes& Map::GetLootTypes() const noexcept {
+    return loot_types_;
+}
+
 const Map::Offices& Map::GetOffices() const noexcept {
     return offices_;
 }
@@ -156,9 +161,14 @@ void Game::LoadState() {
 
     /// move to game
     for (auto &s : sessions_) {
-        sessions[s->GetMap()->GetId()] = s;
+        AddSession(s);
+    }
+
+    for (auto& d : dogs_) {
+        d->SetInGameSince(game_time_);
     }
 
+    std::unique_lock lock(app::Players::players_mutex);
     for (auto& p : players_) {
         app::Players::players.emplace_back(std::move(p));
     }
@@ -183,21 +193,13 @@ void Game::SaveState() {
         ///0 loots
         size_t loot_count = 0;;
         for (auto& s : sessions) {
-            for (auto& l : s.second->GetLoots()) {
+            for (auto& l : s->GetLoots()) {
                 loot_count += 1;
             }
         }
-        for (auto& s : sessions) {
-            for (auto& d : s.second->GetDogs()) {
-                for (auto& l : d->GetLootInBag()) {
-                    loot_count += 1;
-                }
-            }
-        }
-
         output_archive << loot_count;
         for (auto& s : sessions) {
-            for (auto& l : s.second->GetLoots()) {
+            for (auto& l : s->GetLoots()) {
                 serialization::LootRepr repr_loot(l);
                 output_archive << repr_loot;
             }
@@ -206,13 +208,13 @@ void Game::SaveState() {
         ///1 dogs
         size_t dog_count = 0;;
         for (auto& s : sessions) {
-            for (auto& d : s.second->GetDogs()) {
+            for (auto& d : s->GetDogs()) {
                 dog_count += 1;
             }
         }
         output_archive << dog_count;
         for (auto& s : sessions) {
-            for (auto& d : s.second->GetDogs()) {
+            for (auto& d : s->GetDogs()) {
                 serialization::DogRepr repr_dog(*d);
                 output_archive << repr_dog;
             }
@@ -222,11 +224,12 @@ void Game::SaveState() {
         size_t session_count = sessions.size();
         output_archive << session_count;
         for (auto& s : sessions) {
-            serialization::GameSessionRepr repr_session(s.second);
+            serialization::GameSessionRepr repr_session(s);
             output_archive << repr_session;
         }
 
         ///3 players
+        std::shared_lock lock(app::Players::players_mutex);
         size_t players_count = app::Players::players.size();
         output_archive << players_count;
         for (auto& p : app::Players::players) {
@@ -290,7 +293,7 @@ void Game::SaveState() {
 
  DogSharedPtr Game::GetDogByID(std::uint64_t dog_id) {
      for (auto& s : sessions) {
-         for (auto& dog : s.second->GetDogs()) {
+         for (auto& dog : s->GetDogs()) {
              if (dog->GetId() == dog_id) {
                  return dog;
              }
@@ -299,13 +302,40 @@ void Game::SaveState() {
      return nullptr;
  }
 
+std::optional<Map::Index> Game::FindMapIndex(const Map::Id& id) const noexcept {
+    if (auto it = map_id_to_index_.find(id); it != map_id_to_index_.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+std::vector<EntityFootprint> Game::GetMemoryReport() const {
+    std::size_t dogs_count = 0;
+    std::size_t loots_count = 0;
+    for (auto& s : sessions) {
+        dogs_count += s->GetDogs().size();
+        loots_count += s->GetLoots().size();
+    }
+
+    return {
+        { "Map"s,         sizeof(Map),         maps_.size() },
+        { "GameSession"s, sizeof(GameSession), sessions.size() },
+        { "Dog"s,         sizeof(Dog),         dogs_count },
+        { "Loot"s,        sizeof(Loot),        loots_count },
+        { "Player"s,      sizeof(app::Player), app::Players::players.size() },
+    };
+}
+
 MapPoint Game::GetRandomMapPointOnRoads(const Map::Id& id)
 {
-    std::random_device rd;
-    size_t map_index = map_id_to_index_[id];
+    return GetRandomMapPointOnRoads(map_id_to_index_.at(id));
+}
+
+MapPoint Game::GetRandomMapPointOnRoads(Map::Index map_index)
+{
     int number_of_roads = int(maps_[map_index]->GetRoads().size()) - 1;
     std::uniform_int_distribution<int> dist(0, number_of_roads);
-    auto& random_road = maps_[map_index]->GetRoads()[dist(rd)];
+    auto& random_road = maps_[map_index]->GetRoads()[dist(random_engine_)];
 
     int x1 = random_road.GetStart().x;
     int y1 = random_road.GetStart().y;
@@ -319,8 +349,8 @@ MapPoint Game::GetRandomMapPointOnRoads(const Map::Id& id)
     }
     std::uniform_int_distribution<int> dist_x(x1, x2);
     std::uniform_int_distribution<int> dist_y(y1, y2);
-    int x_random_at_map = dist_x(rd);
-    int y_random_at_map = dist_y(rd);
+    int x_random_at_map = dist_x(random_engine_);
+    int y_random_at_map = dist_y(random_engine_);
 
     return MapPoint(x_random_at_map, y_random_at_map);
 }
@@ -331,7 +361,14 @@ const Double Map::GetDogSpeed() const noexcept {
 const int Map::GetBagCapacity() const noexcept {
     return bag_capacity_;
 }
-;
+
+Map::Index Map::GetIndex() const noexcept {
+    return index_;
+}
+
+void Map::SetIndex(Index index) {
+    index_ = index;
+}
 
 void Map::AddRoad(const Road& road) {
     roads_.emplace_back(road);
@@ -357,6 +394,10 @@ void Map::AddOffice(const Office & office) {
     }
 }
 
+void Map::AddLootType(LootType loot_type) {
+    loot_types_.push_back(std::move(loot_type));
+}
+
 void Game::SetLootConfig(const LootConfig& config)
 {
     loot_config_ = config;
@@ -371,18 +412,24 @@ void Map::SetBagCapacity(int bag_capacity) {
 
 void Game::UpdatePositionAndBag(GameSessionSharedPtr& session, std::uint64_t timeDelta) {
     MapSharedPtr map = session->GetMap();
-    collision_detector::ConcreteProvider provider;
+    std::pmr::memory_resource* arena = tick_arena_->Resource();
+    collision_detector::ConcreteProvider provider(arena);
+
+    typedef bg::model::point<double, 2, bg::cs::cartesian> point_t;
+    /// временные контейнеры заводим один раз на вызов и только очищаем в циклах
+    std::pmr::vector<point_t> intersection_point(arena);
+    std::pmr::vector<MapPoint> crossed_lines(arena);
+    std::pmr::vector<MapPoint> crossed_lines_with_good_path(arena);
 
     //first part
     for (auto& dog : session->GetDogs()) {
         auto dog_start_pos = dog->GetPosition();
-        auto cross = [](const MapLine& a, const MapLine& b)->std::optional<MapPoint> {
-            typedef bg::model::point<double, 2, bg::cs::cartesian> point_t;
+        auto cross = [&intersection_point](const MapLine& a, const MapLine& b)->std::optional<MapPoint> {
             typedef bg::model::segment<point_t> segment_t;
     
             segment_t ab(point_t(a.first.x, a.first.y), point_t(a.second.x, a.second.y));
             segment_t cd(point_t(b.first.x, b.first.y), point_t(b.second.x, b.second.y));
-            std::vector<point_t> intersection_point;
+            intersection_point.clear();
             boost::geometry::intersection(ab, cd, intersection_point);
             if (intersection_point.size() == 0) {
                 return std::nullopt;
@@ -401,7 +448,7 @@ void Game::UpdatePositionAndBag(GameSessionSharedPtr& session, std::uint64_t tim
         //
     
         auto lines_from_road = [](const Road& r) {
-            std::vector<MapLine> result;
+            std::array<MapLine, 4> result;
             auto start = r.GetStart();
             auto end = r.GetEnd();
             if (r.IsHorizontal() && (start.x > end.x)) {
@@ -424,10 +471,10 @@ void Game::UpdatePositionAndBag(GameSessionSharedPtr& session, std::uint64_t tim
                 d = MapPoint{ Double(end.x) - road_radius, Double(end.y) + road_radius };
             }
     
-            result.push_back(MapLine{ a,b });
-            result.push_back(MapLine{ b,c });
-            result.push_back(MapLine{ d,c });
-            result.push_back(MapLine{ a,d });
+            result[0] = MapLine{ a,b };
+            result[1] = MapLine{ b,c };
+            result[2] = MapLine{ d,c };
+            result[3] = MapLine{ a,d };
     
             return result;
         };
@@ -460,11 +507,11 @@ void Game::UpdatePositionAndBag(GameSessionSharedPtr& session, std::uint64_t tim
             dog->GetPosition().y + dog->GetSpeed().dy * double(timeDelta) / double(1000));
         MapLine dogMove{ dog->GetPosition(), new_position };
     
-        std::vector<MapPoint> crossed_lines;
+        crossed_lines.clear();
         bool new_pos_inside_rectangle = false;
     
         for (auto& r : map->GetRoads()) {
-            std::vector<MapLine> borders = lines_from_road(r);
+            const auto borders = lines_from_road(r);
             for (auto& l : borders) {
                 auto is_cross = cross(dogMove, l);
                 if (is_cross) {
@@ -496,7 +543,7 @@ void Game::UpdatePositionAndBag(GameSessionSharedPtr& session, std::uint64_t tim
         }
         else {///crossed_lines.size() > 1
             crossed_lines.push_back(new_position);
-            std::vector<MapPoint> crossed_lines_with_good_path;
+            crossed_lines_with_good_path.clear();
             for (int i = 0; i < crossed_lines.size(); i++) {
                 auto x1 = dog->GetPosition().x;
                 auto y1 = dog->GetPosition().y;
@@ -609,25 +656,23 @@ void Game::UpdatePositionAndBag(GameSessionSharedPtr& session, std::uint64_t tim
         provider.AddItem({ geom::Point2D(l->GetPos().x, l->GetPos().y), 0.0, l->GetId() });
     }
     
-    std::uint64_t id_for_office = std::numeric_limits< std::uint64_t > ::max();
-    std::map< std::uint64_t, std::string > item_id_to_office_id;
+    /// офисы идут в провайдер с id от max() вниз: id офиса = max() - индекс офиса на карте
+    constexpr std::uint64_t first_office_item_id = std::numeric_limits< std::uint64_t > ::max();
+    const std::uint64_t offices_count = map->GetOffices().size();
+    std::uint64_t id_for_office = first_office_item_id;
     for (auto& o : map->GetOffices()) {
         auto o_pos = o.GetPosition();
-        item_id_to_office_id[id_for_office] = *o.GetId();
         provider.AddItem({ geom::Point2D(o_pos.x, o_pos.y), 0.5, id_for_office });
         --id_for_office;
     }
     
     auto is_this_office = [&](const collision_detector::GatheringEvent & event) {
-        if (item_id_to_office_id.find(event.item_id) == item_id_to_office_id.end()) {
-            return false;
-        }
-        return true;
+        return first_office_item_id - event.item_id < offices_count;
     };
 
-    auto collision_events = FindGatherEvents(provider);
+    auto collision_events = FindGatherEvents(provider, arena);
 
-    std::vector< size_t > already_collected_loot;
+    std::pmr::vector< size_t > already_collected_loot(arena);
     for (auto& event : collision_events) {
         auto dog__ = session->GetDog(event.gatherer_id);
         if (dog__ == nullptr) return;
@@ -642,9 +687,7 @@ void Game::UpdatePositionAndBag(GameSessionSharedPtr& session, std::uint64_t tim
                 event.item_id) != already_collected_loot.end()) {
                 continue;
             }
-            auto loot_list_size = dog__->GetLootList().size();
-            auto bag_capacity = static_cast<int>(map->GetBagCapacity());
-            if (loot_list_size  < bag_capacity) {
+            if (dog__->IsBagFull() == false) {
                 dog__->AddLoot(session->GetLoot(event.item_id));
                 already_collected_loot.push_back(event.item_id);
             }
@@ -660,7 +703,9 @@ void Game::AddMap(MapSharedPtr map) {
     }
     else {
         try {
+            map->SetIndex(index);
             maps_.emplace_back(map);
+            session_by_map_index_.resize(maps_.size());
         }
         catch (...) {
             map_id_to_index_.erase(it);
@@ -681,30 +726,83 @@ MapSharedPtr Game::FindMap(const Map::Id& id) const noexcept {
 };
 
 std::optional<GameSessionSharedPtr> Game::AddDogToSession(DogSharedPtr dog, const Map::Id& id) {
-    bool have_map_id = map_id_to_index_.contains(id);
-    if (randomize_spawn_points && have_map_id) {
-        dog->SetPos(GetRandomMapPointOnRoads(id));
+    auto map_index = FindMapIndex(id);
+    if (map_index == std::nullopt) {
+        return std::nullopt;
+    }
+    return AddDogToSession(dog, map_index.value());
+}
+
+std::optional<GameSessionSharedPtr> Game::AddDogToSession(DogSharedPtr dog, Map::Index map_index) {
+    if (map_index >= maps_.size()) {
+        return std::nullopt;
+    }
+    PlaceNewDog(dog, map_index);
+
+    auto session = session_by_map_index_[map_index];
+    if (session == nullptr) {
+        /// сессию публикуем уже с собакой: запросы к этой карте начнут идти в strand сессии сразу после AddSession
+        session = GameSessionSharedPtr(new GameSession(maps_[map_index]));
+        session->AddDog(dog);
+        AddSession(session);
+        return session;
+    }
+    session->AddDog(dog);
+    return session;
+}
+
+std::optional<GameSessionSharedPtr> Game::AddDogsToSession(const std::vector<DogSharedPtr>& dogs, Map::Index map_index) {
+    if (map_index >= maps_.size()) {
+        return std::nullopt;
     }
-    else if(have_map_id && maps_[map_id_to_index_[id]]->GetRoads().size()) {
-        int x_at_frist_road_start = maps_[map_id_to_index_[id]]->GetRoads()[0].GetStart().x;
-        int y_at_frist_road_start = maps_[map_id_to_index_[id]]->GetRoads()[0].GetStart().y;
+    auto session = session_by_map_index_[map_index];
+    const bool new_session = (session == nullptr);
+    if (new_session) {
+        session = GameSessionSharedPtr(new GameSession(maps_[map_index]));
+    }
+    session->ReserveDogs(dogs.size());
+    for (const auto& dog : dogs) {
+        PlaceNewDog(dog, map_index);
+        session->AddDog(dog);
+    }
+    if (new_session) {
+        AddSession(session);
+    }
+    return session;
+}
+
+void Game::PlaceNewDog(const DogSharedPtr& dog, Map::Index map_index) {
+    dog->SetInGameSince(game_time_);
+    auto& map = maps_[map_index];
+    if (randomize_spawn_points) {
+        dog->SetPos(GetRandomMapPointOnRoads(map_index));
+    }
+    else if(map->GetRoads().size()) {
+        int x_at_frist_road_start = map->GetRoads()[0].GetStart().x;
+        int y_at_frist_road_start = map->GetRoads()[0].GetStart().y;
 
         dog->SetPos(MapPoint(x_at_frist_road_start, y_at_frist_road_start));
     }
+}
 
-    if (sessions.contains(id)) {
-        sessions[id]->AddDog(dog);
-        return sessions[id];
+GameSessionSharedPtr Game::FindSession(Map::Index map_index) const noexcept {
+    if (map_index >= session_by_map_index_.size()) {
+        return nullptr;
     }
-    else {
-        auto map = FindMap(id);
-        if (map == nullptr) {
-            return std::nullopt;
-        }
-        sessions[id] = GameSessionSharedPtr(new GameSession(map));
-        sessions[id]->AddDog(dog);
-        return sessions[id];
+    return std::atomic_load(&session_by_map_index_[map_index]);
+}
+
+void Game::AddSession(GameSessionSharedPtr session) {
+    auto map_index = session->GetMap()->GetIndex();
+    if (map_index >= session_by_map_index_.size()) {
+        throw std::logic_error("session map is not registered in game");
+    }
+    if (session_by_map_index_[map_index] != nullptr) {
+        throw std::logic_error("session for map already exists");
     }
+    session->PublishSnapshot();
+    std::atomic_store(&session_by_map_index_[map_index], session);
+    sessions.push_back(session);
 }
 
 void Game::SetDefaultDogSpeed(const Double& default_dog_speed){
@@ -723,63 +821,109 @@ int Game::DefaultBagCapacity() {
     return default_bag_capacity_;
 }
 
+void Game::Submit(Command command) {
+    if (GetTickPeriod() == Game::TICK_TESTING_MODE) {
+        command();
+        PublishSnapshots();
+        return;
+    }
+    commands_->Push(std::move(command));
+}
+
+void Game::SetTickObserver(std::function<void()> observer) {
+    tick_observer_ = std::move(observer);
+}
+
+void Game::ExecuteCommands() {
+    while (auto command = commands_->TryPop()) {
+        (*command)();
+    }
+}
+
+void Game::PublishSnapshots() {
+    for (auto& s : sessions) {
+        s->PublishSnapshot();
+    }
+}
+
 void Game::Update(std::uint64_t timeDelta) {
+    ExecuteCommands();
+    UpdateWorld(timeDelta);
+    tick_arena_->Reset();
+    PublishSnapshots();
+    if (tick_observer_) {
+        tick_observer_();
+    }
+
+    if (GetTickPeriod() == Game::TICK_TESTING_MODE) {
+        SaveState();
+        return;
+    }
+    if (GetNeedToSaveState() == true) {
+        SetNeedToSaveState(false);
+        SaveState();
+        ticker_save_state_->SingleShot();
+    }
+}
+
+void Game::UpdateWorld(std::uint64_t timeDelta) {
+    const std::uint64_t tick_start = game_time_;
+    game_time_ += timeDelta;
+
+    std::pmr::vector<MapPoint> dog_start_pos(tick_arena_->Resource());
     for (auto& s : sessions) {
-        std::map<std::uint64_t, MapPoint> dogPos;
-        for (auto& dog : s.second->GetDogs()) {
-            dogPos[dog->GetId()] = dog->GetPosition();
-            if (dog_in_game_time_.find(dog->GetId()) == dog_in_game_time_.end()) {
-                dog_in_game_time_[dog->GetId()] = timeDelta;
-            }
-            else {
-                dog_in_game_time_[dog->GetId()] += timeDelta;
-            }
+        const auto& dogs = s->GetDogs();
+        dog_start_pos.clear();
+        for (auto& dog : dogs) {
+            dog_start_pos.push_back(dog->GetPosition());
         }
-        UpdatePositionAndBag(s.second,timeDelta);
-        for (auto& dog : s.second->GetDogs()) {
-            auto dogId = dog->GetId();
+        UpdatePositionAndBag(s,timeDelta);
+        for (size_t i = 0; i < dogs.size(); i++) {
+            auto& dog = dogs[i];
             /// first && condition to pass test
-            if ( ((dog->NumberOfDogMoves()<=2l) && (dogPos[dogId] == dog->GetPosition())) || (dog->GetDirection() == NONE)) {
-                not_active_dogs_[dogId] += timeDelta;
+            bool is_idle = ((dog->NumberOfDogMoves()<=2l) && (dog_start_pos[i] == dog->GetPosition())) || (dog->GetDirection() == NONE);
+            if (is_idle && (dog->GetIdleSince() == std::nullopt)) {
+                dog->SetIdleSince(tick_start);
+                retirement_timers_.Schedule(dog->GetId(), tick_start + GetDogRetirementTime());
             }
-            else {
-                not_active_dogs_.erase(dogId);
+            else if (!is_idle && dog->GetIdleSince().has_value()) {
+                dog->SetIdleSince(std::nullopt);
             }
         }
-        UpdateLoot(s.second, std::chrono::milliseconds(timeDelta));
+        UpdateLoot(s, std::chrono::milliseconds(timeDelta));
     }
 
-    std::vector<std::uint64_t> dog_id_to_delete;
-    for (auto& dog_timer : not_active_dogs_) {
-        if (dog_timer.second >= GetDogRetirementTime()) {
-            dog_id_to_delete.push_back(dog_timer.first);
-        }
-    }
-    for (const auto& dog_id : dog_id_to_delete) {
+    /// таймер мог устареть: собака успела побегать и снова встать, тогда актуален только более поздний.
+    /// Срок в прошлом колесо сдвигает на текущий шаг, поэтому сравниваем через <=, а не на равенство
+    std::pmr::vector<std::uint64_t> dog_id_to_delete(tick_arena_->Resource());
+    retirement_timers_.Advance(game_time_, [&](std::uint64_t dog_id, std::uint64_t expiry) {
         auto dog = GetDogByID(dog_id);
-        if (dog == nullptr) {
-            throw(std::logic_error("dog must be real instance to update it score."));
-        }else{
-        postgres::Database::SaveRecord(GetDBConnectionPool(),
-            PlayerRecord{ dog->GetUUID(),
-                          dog->GetName(),
-                          dog->GetScore(),
-                          static_cast<int>(dog_in_game_time_[dog->GetId()]) });
+        if (dog == nullptr || dog->GetIdleSince() == std::nullopt) {
+            return;
         }
-        app::Players::RemovePlayerFromGameByDogId(dog_id);
-        not_active_dogs_.erase(dog_id);
-        dog_in_game_time_.erase(dog_id);
+        if (dog->GetIdleSince().value() + GetDogRetirementTime() <= expiry) {
+            dog_id_to_delete.push_back(dog_id);
+        }
+    });
+    for (const auto& dog_id : dog_id_to_delete) {
+        RetireDog(dog_id);
     }
-    
-    if (GetTickPeriod() == Game::TICK_TESTING_MODE) {
-        SaveState();
-        return;
+}
+
+void Game::RetireDog(std::uint64_t dog_id) {
+    auto dog = GetDogByID(dog_id);
+    if (dog == nullptr) {
+        throw(std::logic_error("dog must be real instance to update it score."));
     }
-    if (GetNeedToSaveState() == true) {
-        SetNeedToSaveState(false);
-        SaveState();
-        ticker_save_state_->SingleShot();
+    /// без базы (тесты, локальный запуск) рекорд просто не сохраняем
+    if (auto pool = GetDBConnectionPool()) {
+        postgres::Database::SaveRecord(pool,
+            PlayerRecord{ dog->GetUUIDStr(),
+                          dog->GetName(),
+                          dog->GetScore(),
+                          static_cast<int>(game_time_ - dog->GetInGameSince()) });
     }
+    app::Players::RemovePlayerFromGameByDogId(dog_id);
 }
 
 void Game::Update(std::chrono::milliseconds timeDelta)
@@ -794,14 +938,17 @@ void Game::UpdateLoot(GameSessionSharedPtr& session, std::chrono::milliseconds t
     unsigned count_new_loot_to_add = gen.Generate(timeDelta,
                                               static_cast<unsigned>(session->GetLoots().size()),
                                               static_cast<unsigned>(session->GetDogs().size()));
+    const auto map_index = session->GetMap()->GetIndex();
+    const auto& loot_types = session->GetMap()->GetLootTypes();
+    if (loot_types.empty()) {
+        return;
+    }
+    const int count_loots_type = static_cast<int>(loot_types.size());
+    std::uniform_int_distribution<int> dist(0, count_loots_type-1);
     while (count_new_loot_to_add--) {
-        std::random_device rd;
-        auto map_id = session->GetMap()->GetId();
-        int count_loots_type = loot_config_.map_id_to_loot_type_count_[map_id];
-        std::uniform_int_distribution<int> dist(0, count_loots_type-1);
-        int loot_type = dist(rd);
-        MapPoint loot_pos = GetRandomMapPointOnRoads(map_id);
-        int loot_value = loot_config_.map_id_to_loot_type_to_scores_[map_id][loot_type];
+        int loot_type = dist(random_engine_);
+        MapPoint loot_pos = GetRandomMapPointOnRoads(map_index);
+        int loot_value = loot_types[loot_type].value;
         session->AddLoot(std::make_shared< Loot >(loot_type, loot_pos, loot_value));
     }
 }
@@ -827,13 +974,36 @@ std::atomic<std::uint64_t> GameSession::session_counter{1};
 std::atomic<std::uint64_t> Loot::loot_counter{0};
 
  GameSession::GameSession(MapSharedPtr map_) :map(map_) {
-}
+     /// собаки и предметы не отходят от дорог дальше половины ширины дороги
+     constexpr Double margin = 1.;
+     bool first = true;
+     for (const auto& road : map->GetRoads()) {
+         for (const auto& end : { road.GetStart(), road.GetEnd() }) {
+             if (first) {
+                 grid_min_ = grid_max_ = MapPoint(end);
+                 first = false;
+             }
+             grid_min_.x = std::min<Double>(grid_min_.x, end.x);
+             grid_min_.y = std::min<Double>(grid_min_.y, end.y);
+             grid_max_.x = std::max<Double>(grid_max_.x, end.x);
+             grid_max_.y = std::max<Double>(grid_max_.y, end.y);
+         }
+     }
+     grid_min_.x -= margin;
+     grid_min_.y -= margin;
+     grid_max_.x += margin;
+     grid_max_.y += margin;
+ }
 
  void GameSession::AddDog(DogSharedPtr dog) {
-     MapPoint startedPos(map->GetRoads()[0].GetStart());
+     dog->SetBagCapacity(map->GetBagCapacity());
      dogs.push_back(dog);
  }
 
+ void GameSession::ReserveDogs(std::size_t count) {
+     dogs.reserve(dogs.size() + count);
+ }
+
  void GameSession::AddLoot(LootSharedPtr loot) {
      loots.push_back(loot);
  }
@@ -850,7 +1020,7 @@ std::atomic<std::uint64_t> Loot::loot_counter{0};
      return map;
  }
 
- std::vector<DogSharedPtr> GameSession::GetDogs() const noexcept {
+ const Dogs& GameSession::GetDogs() const noexcept {
      return dogs;
  }
 
@@ -863,7 +1033,7 @@ std::atomic<std::uint64_t> Loot::loot_counter{0};
      return nullptr;
  }
 
- Loots GameSession::GetLoots() const noexcept {
+ const Loots& GameSession::GetLoots() const noexcept {
      return loots;
  }
 
@@ -899,17 +1069,223 @@ std::atomic<std::uint64_t> Loot::loot_counter{0};
       dogs.erase(find(dogs.begin(), dogs.end(), GetDog(dog_id)));
   }
 
+ void GameSession::PublishSnapshot() {
+     std::shared_ptr<SessionSnapshot> next;
+     /// снимок уже не опубликован, поэтому новых читателей у него не появится
+     if (spare_snapshot_ != nullptr && spare_snapshot_.use_count() == 1) {
+         std::atomic_thread_fence(std::memory_order_acquire);
+         next = std::move(spare_snapshot_);
+     }
+     else {
+         next = std::make_shared<SessionSnapshot>();
+     }
+
+     next->ResetBodies();
+     next->dogs.clear();
+     for (const auto& dog : dogs) {
+         next->dogs.push_back(SessionSnapshot::DogState{ dog->GetId(),
+                                                         dog->GetPlayerId(),
+                                                         dog->GetInternedName(),
+                                                         dog->GetPosition(),
+                                                         dog->GetSpeed(),
+                                                         dog->GetDirStr(),
+                                                         dog->GetBag(),
+                                                         dog->GetScore() });
+     }
+     std::sort(next->dogs.begin(), next->dogs.end(), [](const auto& lhs, const auto& rhs) {
+         return lhs.id < rhs.id;
+     });
+     next->loots.clear();
+     for (const auto& loot : loots) {
+         next->loots.push_back(SessionSnapshot::LootState{ loot->GetId(), loot->GetType(), loot->GetPos() });
+     }
+     std::sort(next->loots.begin(), next->loots.end(), [](const auto& lhs, const auto& rhs) {
+         return lhs.id < rhs.id;
+     });
+
+     ++tick_;
+     auto& changes = changes_ring_[tick_ % changes_ring_.size()];
+     if (changes != nullptr && changes.use_count() == 1) {
+         std::atomic_thread_fence(std::memory_order_acquire);
+     }
+     else {
+         changes = std::make_shared<TickChanges>();
+     }
+     changes->Clear();
+     changes->tick = tick_;
+     CollectChanges(*snapshot_, *next, *changes);
+
+     next->dogs_grid.SetBounds(grid_min_.x, grid_min_.y, grid_max_.x, grid_max_.y, SessionSnapshot::grid_cell_size);
+     next->dogs_grid.Build(next->dogs.size(),
+         [&next](std::size_t i) { return next->dogs[i].position.x; },
+         [&next](std::size_t i) { return next->dogs[i].position.y; });
+     next->loots_grid.SetBounds(grid_min_.x, grid_min_.y, grid_max_.x, grid_max_.y, SessionSnapshot::grid_cell_size);
+     next->loots_grid.Build(next->loots.size(),
+         [&next](std::size_t i) { return next->loots[i].position.x; },
+         [&next](std::size_t i) { return next->loots[i].position.y; });
+
+     next->tick = tick_;
+     for (std::size_t i = 0; i < next->changes.size(); ++i) {
+         next->changes[i] = (i < tick_) ? changes_ring_[(tick_ - i) % changes_ring_.size()] : nullptr;
+     }
+
+     auto previous = std::atomic_exchange(&snapshot_, SessionSnapshotPtr(next));
+     spare_snapshot_ = std::const_pointer_cast<SessionSnapshot>(std::move(previous));
+
+     std::unique_lock lock(tick_waiters_mutex_);
+     if (tick_waiters_.empty()) {
+         return;
+     }
+     auto waiters = std::move(tick_waiters_);
+     tick_waiters_.clear();
+     lock.unlock();
+     for (auto& [wait_id, waiter] : waiters) {
+         waiter();
+     }
+ }
+
+ std::uint64_t GameSession::WaitForNextTick(std::uint64_t after_tick, std::function<void()> waiter) {
+     std::unique_lock lock(tick_waiters_mutex_);
+     /// снимок публикуется до захвата мьютекса в PublishSnapshot: если здесь он ещё старый, waiter дождётся его публикации
+     if (GetSnapshot()->tick <= after_tick) {
+         const auto wait_id = next_tick_wait_id_++;
+         tick_waiters_.emplace_back(wait_id, std::move(waiter));
+         return wait_id;
+     }
+     lock.unlock();
+     waiter();
+     return 0;
+ }
+
+ void GameSession::CancelTickWait(std::uint64_t wait_id) {
+     std::lock_guard lock(tick_waiters_mutex_);
+     std::erase_if(tick_waiters_, [wait_id](const auto& waiter) {
+         return waiter.first == wait_id;
+     });
+ }
+
+ void GameSession::CollectChanges(const SessionSnapshot& prev, const SessionSnapshot& next, TickChanges& changes) {
+     auto same_state = [](const SessionSnapshot::DogState& lhs, const SessionSnapshot::DogState& rhs) {
+         return lhs.position == rhs.position &&
+                lhs.speed == rhs.speed &&
+                lhs.dir == rhs.dir &&
+                lhs.bag == rhs.bag &&
+                lhs.score == rhs.score;
+     };
+     /// оба снимка отсортированы по id - сравниваем слиянием
+     auto prev_dog = prev.dogs.begin();
+     for (const auto& dog : next.dogs) {
+         while (prev_dog != prev.dogs.end() && prev_dog->id < dog.id) {
+             changes.removed_players.push_back(prev_dog->player_id);
+             ++prev_dog;
+         }
+         if (prev_dog != prev.dogs.end() && prev_dog->id == dog.id) {
+             if (!same_state(*prev_dog, dog)) {
+                 changes.changed_dogs.push_back(dog.id);
+             }
+             ++prev_dog;
+         }
+         else {
+             changes.changed_dogs.push_back(dog.id);
+         }
+     }
+     for (; prev_dog != prev.dogs.end(); ++prev_dog) {
+         changes.removed_players.push_back(prev_dog->player_id);
+     }
+
+     /// предметы после появления не меняются: только появляются и исчезают
+     auto prev_loot = prev.loots.begin();
+     for (const auto& loot : next.loots) {
+         while (prev_loot != prev.loots.end() && prev_loot->id < loot.id) {
+             changes.removed_loots.push_back(prev_loot->id);
+             ++prev_loot;
+         }
+         if (prev_loot != prev.loots.end() && prev_loot->id == loot.id) {
+             ++prev_loot;
+         }
+         else {
+             changes.changed_loots.push_back(loot.id);
+         }
+     }
+     for (; prev_loot != prev.loots.end(); ++prev_loot) {
+         changes.removed_loots.push_back(prev_loot->id);
+     }
+ }
+
+ SessionSnapshotPtr GameSession::GetSnapshot() const {
+     return std::atomic_load(&snapshot_);
+ }
+
+ void SessionSnapshot::ResetBodies() noexcept {
+     for (auto& body : bodies_) {
+         body.reset();
+     }
+ }
+
+ void TickChanges::Clear() noexcept {
+     tick = 0;
+     changed_dogs.clear();
+     changed_loots.clear();
+     removed_players.clear();
+     removed_loots.clear();
+ }
+
+ const SessionSnapshot::LootState* SessionSnapshot::FindLoot(std::uint64_t loot_id) const noexcept {
+     auto it = std::lower_bound(loots.begin(), loots.end(), loot_id, [](const LootState& loot, std::uint64_t id) {
+         return loot.id < id;
+     });
+     if (it == loots.end() || it->id != loot_id) {
+         return nullptr;
+     }
+     return &*it;
+ }
+
+ std::optional<TickChanges> SessionSnapshot::ChangesSince(std::uint64_t since) const {
+     if (since > tick || tick - since > changes_history) {
+         return std::nullopt;
+     }
+     TickChanges result;
+     result.tick = tick;
+     for (std::uint64_t i = 0; i < tick - since; ++i) {
+         const auto& tick_changes = changes[i];
+         if (tick_changes == nullptr) {
+             return std::nullopt;
+         }
+         auto append = [](std::vector<std::uint64_t>& to, const std::vector<std::uint64_t>& from) {
+             to.insert(to.end(), from.begin(), from.end());
+         };
+         append(result.changed_dogs, tick_changes->changed_dogs);
+         append(result.changed_loots, tick_changes->changed_loots);
+         append(result.removed_players, tick_changes->removed_players);
+         append(result.removed_loots, tick_changes->removed_loots);
+     }
+     for (auto* ids : { &result.changed_dogs, &result.changed_loots, &result.removed_players, &result.removed_loots }) {
+         std::sort(ids->begin(), ids->end());
+         ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+     }
+     return result;
+ }
+
+ const SessionSnapshot::DogState* SessionSnapshot::FindDog(std::uint64_t dog_id) const noexcept {
+     auto it = std::lower_bound(dogs.begin(), dogs.end(), dog_id, [](const DogState& dog, std::uint64_t id) {
+         return dog.id < id;
+     });
+     if (it == dogs.end() || it->id != dog_id) {
+         return nullptr;
+     }
+     return &*it;
+ }
+
  Dog::Dog() {
      id_ = dog_counter++;
-     name_ = "Dog_";
-     name_.append(std::to_string(id_));
+     name_ = util::InternedString("Dog_"s + std::to_string(id_));
      pos_.x = 0;
      pos_.y = 0;
      speed_.dx = 0;
      speed_.dy = 0;
      dir_ = UP;
      score_ = 0;
-     uuid_ = util::detail::UUIDToString(util::detail::NewUUID());
+     uuid_ = util::detail::NewUUID();
  }
 
  Dog::Dog(std::string name) :name_(name) {
@@ -920,10 +1296,14 @@ std::atomic<std::uint64_t> Loot::loot_counter{0};
      speed_.dy = 0;
      dir_ = UP;
      score_ = 0;
-     uuid_ = util::detail::UUIDToString(util::detail::NewUUID());
+     uuid_ = util::detail::NewUUID();
  }
 
- std::string Dog::GetName() const noexcept {
+ const std::string& Dog::GetName() const noexcept {
+     return *name_;
+ }
+
+ const util::InternedString& Dog::GetInternedName() const noexcept {
      return name_;
  }
 
@@ -959,42 +1339,46 @@ std::atomic<std::uint64_t> Loot::loot_counter{0};
      if (loot == nullptr) {
          throw std::runtime_error("try to add loot when it nullptr");
      }
-     bag_.push_back(loot);
+     AddLoot(BagItem{ loot->GetId(), loot->GetType(), loot->GetValue() });
+ }
+
+ void Dog::AddLoot(const BagItem& item) {
+     if (IsBagFull()) {
+         throw std::logic_error("try to add loot when bag is full");
+     }
+     bag_.push_back(item);
  }
 
   void Dog::SetName(const std::string& name) {
-     name_ = name;
+     name_ = util::InternedString(name);
  }
 
   void Dog::SetId(const std::uint64_t& id) {
      id_ = id;
  }
 
- std::vector<std::uint64_t> Dog::GetLootList() {
-     std::vector<std::uint64_t> result;
-     if(bag_.size() > 0){
-        for (const auto& l : bag_) {
-            result.push_back(l->GetId());
-        }
+ void Dog::SetBagCapacity(int bag_capacity) {
+     bag_capacity_ = bag_capacity;
+     if (bag_capacity_ > 0) {
+         bag_.reserve(static_cast<std::size_t>(bag_capacity_));
      }
-     return result;
  }
 
- LootSharedPtr Dog::GetLoot(std::uint64_t id){
-     LootSharedPtr result = nullptr;
-     auto it = bag_.begin();
-     for (; it != bag_.end(); it++) {
-         if (it->get()->GetId() == id) {
-             result = *it;
-             break;
-         }
-     }
-     return result;
+ int Dog::GetBagCapacity() const noexcept {
+     return bag_capacity_;
+ }
+
+ bool Dog::IsBagFull() const noexcept {
+     return static_cast<int>(bag_.size()) >= bag_capacity_;
+ }
+
+ const LootBag& Dog::GetBag() const noexcept {
+     return bag_;
  }
 
  void Dog::ReleaseLootBag() {
-     for (auto& loot_in_bag : bag_) {
-         score_ += loot_in_bag->GetValue();
+     for (const auto& item : bag_) {
+         score_ += item.value;
      }
      bag_.clear();
  }
@@ -1032,28 +1416,52 @@ std::atomic<std::uint64_t> Loot::loot_counter{0};
      return score_;
  }
 
-  Loots Dog::GetLootInBag(){
-     return bag_;
- }
-
   void Dog::UpdateDogCounter() {
      if (id_ > dog_counter) {
          dog_counter = id_;
      }
  }
 
-  void Dog::SetUUID(const std::string& uuid) {
+  void Dog::SetUUID(const util::detail::UUIDType& uuid) {
       uuid_ = uuid;
   }
 
-  std::string Dog::GetUUID() {
+  const util::detail::UUIDType& Dog::GetUUID() const noexcept {
       return uuid_;
   }
 
+  std::string Dog::GetUUIDStr() const {
+      return util::detail::UUIDToString(uuid_);
+  }
+
   long long Dog::NumberOfDogMoves() {
       return ++number_of_dog_moves_;
   }
 
+  void Dog::SetInGameSince(std::uint64_t game_time) {
+      in_game_since_ = game_time;
+  }
+
+  std::uint64_t Dog::GetInGameSince() const noexcept {
+      return in_game_since_;
+  }
+
+  void Dog::SetIdleSince(std::optional<std::uint64_t> game_time) {
+      idle_since_ = game_time;
+  }
+
+  std::optional<std::uint64_t> Dog::GetIdleSince() const noexcept {
+      return idle_since_;
+  }
+
+  void Dog::SetPlayerId(std::uint64_t player_id) {
+      player_id_ = player_id;
+  }
+
+  std::uint64_t Dog::GetPlayerId() const noexcept {
+      return player_id_;
+  }
+
  Loot::Loot(int loot_type, MapPoint position, int value)
      :loot_type_(loot_type),
      position_(position),
@@ -2,17 +2,28 @@
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include <array>
 #include <memory>
 #include <iostream>
 #include <atomic>
 #include <cassert>
 #include <optional>
 #include <filesystem>
+#include <functional>
+#include <mutex>
+#include <random>
 
 #include <boost/geometry.hpp>
+#include <boost/container/small_vector.hpp>
 
 #include "tagged.h"
+#include "tagged_uuid.h"
+#include "interned_string.h"
 #include "collision_detector.h"
+#include "timer_wheel.h"
+#include "tick_arena.h"
+#include "spatial_grid.h"
+#include "mpsc_queue.h"
 #include "ticker.h"
 #include "postgres.h"
 #include "logger.h"
@@ -130,12 +141,26 @@ private:
     Offset offset_;
 };
 
+/// Тип трофея карты из lootTypes конфига. Индекс в Map::GetLootTypes - тип Loot
+struct LootType {
+    std::string name;
+    /// ассет для клиента (поле file)
+    std::string file;
+    /// очки за сданный трофей
+    int value = 0;
+    /// объект из конфига как есть, уже сериализованный: в таком виде он уходит клиенту в /maps/{id}
+    std::string json;
+};
+
 class Map {
 public:
     using Id = util::Tagged<std::string, Map>;
+    /// Плотный индекс карты, выдаётся в Game::AddMap. Строковый Id нужен только на границе JSON.
+    using Index = std::size_t;
     using Roads = std::vector<Road>;
     using Buildings = std::vector<Building>;
     using Offices = std::vector<Office>;
+    using LootTypes = std::vector<LootType>;
 
     Map(Id id, std::string name) noexcept;
 
@@ -144,11 +169,15 @@ public:
     const Buildings& GetBuildings() const noexcept;
     const Roads& GetRoads() const noexcept;
     const Offices& GetOffices() const noexcept;
+    const LootTypes& GetLootTypes() const noexcept;
     const Double GetDogSpeed() const noexcept;
-    const int GetBagCapacity() const noexcept;;
+    const int GetBagCapacity() const noexcept;
+    Index GetIndex() const noexcept;
+    void SetIndex(Index index);
     void AddRoad(const Road& road);
     void AddBuilding(const Building& building);
     void AddOffice(const Office & office);
+    void AddLootType(LootType loot_type);
     void SetDogSpeed(const Double& dog_speed);
     void SetBagCapacity(int bag_capacity);
 
@@ -162,8 +191,10 @@ private:
 
     OfficeIdToIndex warehouse_id_to_index_;
     Offices offices_;
+    LootTypes loot_types_;
     Double dog_speed_;
     int bag_capacity_;
+    Index index_{ 0 };
 };
 
 class Loot {
@@ -189,21 +220,38 @@ private:
     static std::atomic<std::uint64_t> loot_counter;
 };
 
+/// Предмет в рюкзаке собаки. Хранится по значению, без ссылки на Loot.
+struct BagItem {
+    std::uint64_t id;
+    int type;
+    int value;
+    bool operator==(const BagItem& rhs) const = default;
+};
+
+/// Сколько предметов рюкзак держит без обращения к куче.
+/// Если bagCapacity карты больше, память резервируется один раз при входе собаки в сессию.
+constexpr std::size_t bag_inline_capacity = 8;
+using LootBag = boost::container::small_vector<BagItem, bag_inline_capacity>;
+
 class Dog {
 public:
     Dog();
     Dog(std::string name_);
-    std::string GetName() const noexcept;
+    const std::string& GetName() const noexcept;
+    const util::InternedString& GetInternedName() const noexcept;
     void SetPos(const MapPoint& p);
     void SetSpeed(const MapSpeed& s);
     void SetDirection(const DIRECTION& d);
     void SetDirection(const std::string& d);
     void SetScore(int score);;
     void AddLoot(LootSharedPtr loot);
+    void AddLoot(const BagItem& item);
     void SetName(const std::string& name);
     void SetId(const std::uint64_t& id);
-    std::vector<std::uint64_t> GetLootList();
-    LootSharedPtr GetLoot(std::uint64_t id);
+    void SetBagCapacity(int bag_capacity);
+    int GetBagCapacity() const noexcept;
+    bool IsBagFull() const noexcept;
+    const LootBag& GetBag() const noexcept;
     void ReleaseLootBag();
     MapPoint GetPosition() const noexcept;
     MapSpeed GetSpeed() const noexcept;
@@ -211,62 +259,220 @@ public:
     std::string GetDirStr() const ;
     uint64_t GetId() const noexcept;
     int GetScore()const noexcept;
-    Loots GetLootInBag();
     void UpdateDogCounter();;
-    void SetUUID(const std::string& uuid);;
-    std::string GetUUID();
+    void SetUUID(const util::detail::UUIDType& uuid);
+    const util::detail::UUIDType& GetUUID() const noexcept;
+    std::string GetUUIDStr() const;
     long long NumberOfDogMoves();;
+    /// Игровое время (мс), с которого собака в игре
+    void SetInGameSince(std::uint64_t game_time);
+    std::uint64_t GetInGameSince() const noexcept;
+    /// Игровое время (мс), с которого собака неактивна. nullopt - собака активна
+    void SetIdleSince(std::optional<std::uint64_t> game_time);
+    std::optional<std::uint64_t> GetIdleSince() const noexcept;
+    /// id игрока, которому принадлежит собака. Выставляет app::Player
+    void SetPlayerId(std::uint64_t player_id);
+    std::uint64_t GetPlayerId() const noexcept;
 
 private:
     static std::atomic<std::uint64_t> dog_counter;
     std::uint64_t id_;
-    std::string name_;
+    util::InternedString name_;
     MapPoint pos_;
     MapSpeed speed_;
     DIRECTION dir_;
-    Loots bag_{Loots()};
+    LootBag bag_;
+    int bag_capacity_{ static_cast<int>(bag_inline_capacity) };
     int score_;
-    std::string uuid_;
+    util::detail::UUIDType uuid_;
     long long number_of_dog_moves_{ 0 };
+    std::uint64_t in_game_since_{ 0 };
+    std::optional<std::uint64_t> idle_since_;
+    std::uint64_t player_id_{ 0 };
 };
 
+/// Что изменилось в сессии за один тик
+struct TickChanges {
+    void Clear() noexcept;
+
+    std::uint64_t tick = 0;
+    /// появившиеся или изменившиеся собаки и предметы: их состояние берётся из снимка
+    std::vector<std::uint64_t> changed_dogs;
+    std::vector<std::uint64_t> changed_loots;
+    /// собак ушедших игроков в снимке уже нет, поэтому храним id игроков
+    std::vector<std::uint64_t> removed_players;
+    std::vector<std::uint64_t> removed_loots;
+};
+
+/*
+ *  Неизменяемый снимок сессии на конец тика.
+ *  Поток тика публикует его атомарной заменой shared_ptr, читающие запросы берут снимок
+ *  из любого потока без блокировок и не видят мир посреди обновления.
+ */
+struct SessionSnapshot {
+    struct DogState {
+        std::uint64_t id;
+        std::uint64_t player_id;
+        /// ссылка на строку из пула имён: держит её, пока жив снимок, даже если собака уже ушла из игры
+        util::InternedString name;
+        MapPoint position;
+        MapSpeed speed;
+        std::string dir;
+        LootBag bag;
+        int score;
+    };
+    struct LootState {
+        std::uint64_t id;
+        int type;
+        MapPoint position;
+    };
+
+    /// nullptr, если собаки нет в снимке (добавлена после его публикации)
+    const DogState* FindDog(std::uint64_t dog_id) const noexcept;
+    const LootState* FindLoot(std::uint64_t loot_id) const noexcept;
+
+    /// Сколько последних тиков хранится в changes
+    static constexpr std::size_t changes_history = 32;
+    /*
+     * Объединённые изменения тиков (since, tick].
+     * std::nullopt - since старше истории или из будущего: клиенту нужен полный снимок.
+     */
+    std::optional<TickChanges> ChangesSince(std::uint64_t since) const;
+
+    /// Ответы API, которые целиком определяются снимком
+    enum class CachedBody {
+        STATE,
+        /// /state?sinceTick=tick-1 - его спрашивают все клиенты, успевающие за тиками
+        STATE_SINCE_PREVIOUS_TICK,
+        PLAYERS,
+        /// /state в двоичном виде, см. state_binary.h
+        STATE_BINARY,
+        COUNT
+    };
+    using Body = std::shared_ptr<const std::string>;
+    /// Представлений у каждого тела: исходное и сжатые, номер - http_compression::Encoding
+    static constexpr std::size_t body_encodings = 3;
+    /*
+     * Тело ответа сериализуется один раз на снимок - при первом запросе после тика,
+     * остальные запросы получают тот же буфер.
+     * При гонке двух первых запросов make() может выполниться дважды, сохранится один результат.
+     */
+    template <typename Make>
+    Body GetBody(CachedBody which, Make&& make) const {
+        return GetBody(which, 0, std::forward<Make>(make));
+    }
+    /// То же для сжатого представления тела: сжимается тоже один раз на снимок. encoding 0 - исходное тело
+    template <typename Make>
+    Body GetBody(CachedBody which, std::size_t encoding, Make&& make) const {
+        auto& slot = bodies_[static_cast<std::size_t>(which) * body_encodings + encoding];
+        if (auto body = std::atomic_load(&slot)) {
+            return body;
+        }
+        Body made = std::make_shared<const std::string>(make());
+        Body expected;
+        if (std::atomic_compare_exchange_strong(&slot, &expected, made)) {
+            return made;
+        }
+        return expected;
+    }
+    /// Только для потока тика, пока снимок никому не виден
+    void ResetBodies() noexcept;
+
+    /// номер тика сессии, на конец которого снят снимок. Растёт с каждой публикацией
+    std::uint64_t tick = 0;
+    /// отсортированы по id
+    std::vector<DogState> dogs;
+    std::vector<LootState> loots;
+    /// changes[i] - изменения тика (tick - i). Объекты разделяются между снимками соседних тиков
+    std::array<std::shared_ptr<const TickChanges>, changes_history> changes;
+
+    /// Сторона клетки сетки для выборки по области интереса
+    static constexpr Double grid_cell_size = 10.;
+    /// ForEachNear отдаёт индексы в dogs и loots
+    util::SpatialGrid dogs_grid;
+    util::SpatialGrid loots_grid;
+
+private:
+    mutable std::array<Body, static_cast<std::size_t>(CachedBody::COUNT) * body_encodings> bodies_;
+};
+using SessionSnapshotPtr = std::shared_ptr<const SessionSnapshot>;
+
 class GameSession {
 public:
     GameSession(MapSharedPtr map_);
     void AddDog(DogSharedPtr dog);
+    void ReserveDogs(std::size_t count);
     void AddLoot(LootSharedPtr loot);
     std::uint64_t GetId() const noexcept;
     void SetId(std::uint64_t id_);
     MapSharedPtr GetMap() const noexcept;
-    Dogs GetDogs() const noexcept;
+    const Dogs& GetDogs() const noexcept;
     DogSharedPtr GetDog(std::uint64_t dog_id) const;
-    Loots GetLoots() const noexcept;
+    const Loots& GetLoots() const noexcept;
     LootSharedPtr GetLoot(std::uint64_t id);
     void UpdateGameSessionCounter();
     void RemoveDog(std::uint64_t dog_id);
+    /// Вызывается только из потока тика
+    void PublishSnapshot();
+    SessionSnapshotPtr GetSnapshot() const;
+    /*
+     * waiter выполнится один раз: сразу, если опубликован снимок новее after_tick,
+     * иначе в потоке тика после публикации следующего снимка.
+     * Вызывается из любого потока; waiter не должен надолго занимать поток тика.
+     * Возвращает id ожидания для CancelTickWait, 0 - waiter уже выполнен.
+     */
+    std::uint64_t WaitForNextTick(std::uint64_t after_tick, std::function<void()> waiter);
+    /// Снимает ещё не выполненное ожидание (long-poll по таймауту), иначе ничего не делает
+    void CancelTickWait(std::uint64_t wait_id);
 private:
+    static void CollectChanges(const SessionSnapshot& prev, const SessionSnapshot& next, TickChanges& changes);
+
     Dogs dogs;
     Loots loots;
     MapSharedPtr map;
+    SessionSnapshotPtr snapshot_{ std::make_shared<SessionSnapshot>() };
+    /// предыдущий снимок: когда его отпустят все читатели, он переиспользуется без новых выделений памяти
+    std::shared_ptr<SessionSnapshot> spare_snapshot_;
+    std::uint64_t tick_{ 0 };
+    /// изменения по тикам, индекс - tick % size. Запас в 2 слота: вытесняемый объект уже не входит
+    /// ни в опубликованный снимок, ни в запасной, и его можно переиспользовать
+    std::array<std::shared_ptr<TickChanges>, SessionSnapshot::changes_history + 2> changes_ring_;
+    /// прямоугольник дорог карты с запасом - границы сеток снимков. На карте без дорог - окрестность нуля
+    MapPoint grid_min_{ 0., 0. };
+    MapPoint grid_max_{ 0., 0. };
+    std::mutex tick_waiters_mutex_;
+    std::vector<std::pair<std::uint64_t, std::function<void()>>> tick_waiters_;
+    std::uint64_t next_tick_wait_id_ = 1;
     static std::atomic<std::uint64_t> session_counter;
     std::uint64_t id;
 };
 
+/// Типы трофеев и их ценность - у каждой карты свои, см. Map::GetLootTypes
 struct LootConfig {
-    using Id = util::Tagged<std::string, Map>;
-    using MapIdHasher = util::TaggedHasher<Map::Id>;
-    using MapIdToLootTypeCount = std::unordered_map<Id, int, MapIdHasher>;
-    using MapIdToLootTypeToScores = std::unordered_map<Id, std::unordered_map<int, int>, MapIdHasher>;
     Double period_;
     Double probability_;
-    MapIdToLootTypeCount map_id_to_loot_type_count_;
-    MapIdToLootTypeToScores map_id_to_loot_type_to_scores_;
+};
+
+/// Сколько памяти занимают сущности одного типа: sizeof объекта и число живых объектов.
+/// Память, на которую объект ссылается (строки в пулах, буферы векторов), сюда не входит.
+struct EntityFootprint {
+    std::string name;
+    std::size_t size_of;
+    std::size_t count;
 };
 
 class Game {
     using TickerSaveState = Ticker<std::function<void(void)>>;
+    void ExecuteCommands();
+    void PublishSnapshots();
+    /// время входа и точка появления новой собаки
+    void PlaceNewDog(const DogSharedPtr& dog, Map::Index map_index);
+    /// всё временное внутри UpdateWorld выделяется в tick_arena_
+    void UpdateWorld(std::uint64_t timeDelta);
     void UpdatePositionAndBag(GameSessionSharedPtr& session, std::uint64_t timeDelta);
     void UpdateLoot(GameSessionSharedPtr& session, std::chrono::milliseconds timeDelta);
+    void AddSession(GameSessionSharedPtr session);
+    void RetireDog(std::uint64_t dog_id);
 public:
     enum tick_state {
         TICK_TESTING_MODE = -1
@@ -281,11 +487,27 @@ public:
     void AddMap(MapSharedPtr map);
     const Maps& GetMaps() const noexcept;
     MapSharedPtr FindMap(const Map::Id& id) const noexcept;
+    std::optional<Map::Index> FindMapIndex(const Map::Id& id) const noexcept;
     std::optional<GameSessionSharedPtr> AddDogToSession(DogSharedPtr dog, const Map::Id& id);
+    std::optional<GameSessionSharedPtr> AddDogToSession(DogSharedPtr dog, Map::Index map_index);
+    /// Массовое добавление собак на одну карту: место в сессии резервируется один раз на всех
+    std::optional<GameSessionSharedPtr> AddDogsToSession(const std::vector<DogSharedPtr>& dogs, Map::Index map_index);
+    /// Можно вызывать из любого потока: слот сессии читается атомарно
+    GameSessionSharedPtr FindSession(Map::Index map_index) const noexcept;
     void SetDefaultDogSpeed(const Double& default_dog_speed);
     const Double DefaultDogSpeed() const noexcept;
     void SetDefaultBagCapacity(const int& bag_capacity);
     int DefaultBagCapacity();
+    /// Изменение мира, которое выполнит поток тика
+    using Command = std::function<void()>;
+    /*
+     * Единственный писатель игрового мира - поток тика (ticker_strand).
+     * HTTP-потоки только кладут команду в очередь, Update выполняет накопленные команды в начале тика.
+     * В режиме /tick тикера нет и всё API идёт в одном strand-е, поэтому команда выполняется сразу.
+     */
+    void Submit(Command command);
+    /// Вызывается в потоке тика в конце каждого Update, когда снимки сессий уже опубликованы
+    void SetTickObserver(std::function<void()> observer);
     void Update(std::uint64_t timeDelta);
     void Update(std::chrono::milliseconds timeDelta);
     void SetTickPeriod(int tick_period_);
@@ -295,6 +517,7 @@ public:
     void SetLootConfig(const LootConfig& config);
     const LootConfig& GetLootConfig() const noexcept;
     MapPoint GetRandomMapPointOnRoads(const Map::Id& id);
+    MapPoint GetRandomMapPointOnRoads(Map::Index map_index);
     void LoadState();
     void SaveState();
     void SetSaveFilePath(const std::string& path);
@@ -308,18 +531,24 @@ public:
     void SetDBConnectionPool(ConnectionPoolPtr pool);
     ConnectionPoolPtr GetDBConnectionPool();
     DogSharedPtr GetDogByID(std::uint64_t dog_id);
+    std::vector<EntityFootprint> GetMemoryReport() const;
             
 private:
     using MapIdHasher = util::TaggedHasher<Map::Id>;
     using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
 
     std::vector<MapSharedPtr> maps_;
-    std::unordered_map<Map::Id, GameSessionSharedPtr, MapIdHasher> sessions;
+    std::vector<GameSessionSharedPtr> sessions;
+    /// индекс - Map::Index, nullptr пока на карте нет сессии.
+    /// Размер задаётся в AddMap, слоты пишутся atomic_store из потока тика и читаются atomic_load из потоков ввода-вывода
+    std::vector<GameSessionSharedPtr> session_by_map_index_;
     MapIdToIndex map_id_to_index_;
     Double default_dog_speed_;
     int default_bag_capacity_;
     int tick_period;
     bool randomize_spawn_points;
+    /// один генератор на игру вместо std::random_device на каждую точку; используется только в потоке тика
+    std::mt19937_64 random_engine_{ std::random_device{}() };
     LootConfig loot_config_;
     int save_state_period_;
     bool need_to_save_state_{ false };
@@ -327,8 +556,14 @@ private:
     std::string path_to_state_file_;
     int dog_retirement_time_;
     ConnectionPoolPtr pool_;
-    std::map< std::uint64_t, std::uint64_t > not_active_dogs_;
-    std::map< std::uint64_t, std::uint64_t > dog_in_game_time_;
+    /// суммарное игровое время всех тиков, мс
+    std::uint64_t game_time_{ 0 };
+    /// ключ - id собаки, срабатывает в момент idle_since + dog_retirement_time_
+    util::TimerWheel<std::uint64_t> retirement_timers_;
+    /// временные контейнеры Update живут в арене и освобождаются в конце каждого тика
+    std::unique_ptr<util::TickArena> tick_arena_{ std::make_unique<util::TickArena>() };
+    std::unique_ptr<util::MpscQueue<Command>> commands_{ std::make_unique<util::MpscQueue<Command>>() };
+    std::function<void()> tick_observer_;
 };
 
 }  // namespace model
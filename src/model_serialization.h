@@ -1,5 +1,8 @@
 #pragma once
 #include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
+
+#include <algorithm>
 
 #include "model.h"
 #include "application.h"
@@ -40,6 +43,13 @@ void serialize(Archive& ar, model::DIRECTION& dir, [[maybe_unused]] const unsign
     ar& dir;
 }
 
+template <typename Archive>
+void serialize(Archive& ar, BagItem& item, [[maybe_unused]] const unsigned version) {
+    ar& item.id;
+    ar& item.type;
+    ar& item.value;
+}
+
 }  // namespace model
 
 namespace serialization {
@@ -100,42 +110,38 @@ public:
         , speed_(dog.GetSpeed())
         , dir_(dog.GetDirection())
         , score_(dog.GetScore())
+        , bag_capacity_(dog.GetBagCapacity())
+        , bag_(dog.GetBag().begin(), dog.GetBag().end())
+        , uuid_(dog.GetUUIDStr())
         {
-        for (auto l : dog.GetLootInBag()) {
-            id_loots_in_bag_.push_back(l->GetId());
-        }
-    }
-
-    [[nodiscard]] model::Dog Restore() const {
-        model::Dog dog{ name_ };
-        dog.SetId(id_);
-        dog.SetPos(pos_);
-        dog.SetSpeed(speed_);
-        dog.SetDirection(dir_);
-        dog.SetScore(score_);
-        return dog;
     }
 
-    [[nodiscard]] model::Dog Restore(std::vector< LootSharedPtr>& loots_restored) const {
+    /// loots_restored нужны только для файлов версии 0, где в рюкзаке хранились id трофеев
+    [[nodiscard]] model::Dog Restore(const std::vector<LootSharedPtr>& loots_restored = {}) const {
         model::Dog dog{name_};
         dog.SetId(id_);
         dog.SetPos(pos_);
         dog.SetSpeed(speed_);
         dog.SetDirection(dir_);
         dog.SetScore(score_);
+        if (!uuid_.empty()) {
+            dog.SetUUID(util::detail::UUIDFromString(uuid_));
+        }
 
-        int count_loots_was_found = 0;
-
-        for (auto& l_restored : loots_restored)
-            for (auto& l_id : id_loots_in_bag_) {
-                if (l_restored->GetId() == l_id) {
-                    count_loots_was_found += 1;
-                    dog.AddLoot(l_restored);
-                }
+        auto bag = bag_;
+        for (const auto& loot_id : id_loots_in_bag_) {
+            auto it = std::find_if(loots_restored.begin(), loots_restored.end(), [loot_id](const LootSharedPtr& loot) {
+                return loot->GetId() == loot_id;
+            });
+            if (it == loots_restored.end()) {
+                throw std::logic_error("ERROR: not all loots was found");
             }
-
-        if (count_loots_was_found != id_loots_in_bag_.size()) {
-            throw std::logic_error("ERROR: not all loots was found");
+            bag.push_back(model::BagItem{ (*it)->GetId(), (*it)->GetType(), (*it)->GetValue() });
+        }
+        /// ёмкость рюкзака в версии 0 не сохранялась, настоящую выставит GameSession::AddDog
+        dog.SetBagCapacity(std::max(bag_capacity_, static_cast<int>(bag.size())));
+        for (const auto& item : bag) {
+            dog.AddLoot(item);
         }
 
         dog.UpdateDogCounter();
@@ -143,14 +149,21 @@ public:
     }
 
     template <typename Archive>
-    void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
+    void serialize(Archive& ar, const unsigned version) {
         ar& id_;
         ar& name_;
         ar& pos_;
         ar& speed_;
         ar& dir_;
-        ar& id_loots_in_bag_;
+        if (version == 0) {
+            ar& id_loots_in_bag_;
+            ar& score_;
+            return;
+        }
+        ar& bag_capacity_;
+        ar& bag_;
         ar& score_;
+        ar& uuid_;
     }
 
 private:
@@ -159,8 +172,11 @@ private:
     model::MapPoint pos_;
     model::MapSpeed speed_;
     model::DIRECTION dir_;
-    std::vector<std::uint64_t> id_loots_in_bag_;
     int score_;
+    int bag_capacity_ = 0;
+    std::vector<model::BagItem> bag_;
+    std::string uuid_;
+    std::vector<std::uint64_t> id_loots_in_bag_;
 };
 
 // PlayerRepr (PlayerRepresentation) - сериализованное представление класса Player
@@ -173,7 +189,7 @@ public:
         : id_(player->GetIdAsUInt64())
         , id_dog_(player->GetDog()->GetId())
         , id_session_(player->GetSession()->GetId())
-        , token_(*(player->GetToken()))
+        , token_(app::TokenToString(player->GetToken()))
     {
     }
 
@@ -213,6 +229,7 @@ public:
         return player;
     }
 
+    /// в версии 0 токен хранился той же строкой из 32 hex-цифр, раскладка полей не менялась
     template <typename Archive>
     void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
         ar& id_;
@@ -303,3 +320,7 @@ private:
 };
 
 }  // namespace serialization
+
+/// версия 1: рюкзак хранит сами трофеи и свою ёмкость, у собаки сохраняется UUID, токен игрока хранится в бинарном виде
+BOOST_CLASS_VERSION(::serialization::DogRepr, 1)
+BOOST_CLASS_VERSION(::serialization::PlayerRepr, 1)
@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace util {
+
+/*
+ *  Неблокирующая очередь "много писателей - один читатель" (очередь Вьюкова).
+ *  Push - один exchange и одна запись, его можно вызывать из любых потоков одновременно.
+ *  TryPop вызывает только один поток-читатель.
+ *
+ *  Если писатель прерван между exchange и записью next, читатель увидит очередь пустой
+ *  до этого элемента и заберёт его и всё, что за ним, при следующем TryPop.
+ */
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue()
+        : head_(&stub_)
+        , tail_(&stub_) {
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        while (TryPop()) {
+        }
+        if (tail_ != &stub_) {
+            delete tail_;
+        }
+    }
+
+    void Push(T value) {
+        Node* node = new Node;
+        node->value.emplace(std::move(value));
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    std::optional<T> TryPop() {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return std::nullopt;
+        }
+        // next становится новым пустым узлом-заглушкой, значение из него забираем
+        std::optional<T> value(std::move(next->value));
+        next->value.reset();
+        tail_ = next;
+        if (tail != &stub_) {
+            delete tail;
+        }
+        return value;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{ nullptr };
+        std::optional<T> value;
+    };
+
+    Node stub_;
+    std::atomic<Node*> head_;
+    Node* tail_;
+};
+
+}  // namespace util
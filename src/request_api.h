@@ -2,6 +2,8 @@
 
 #include "response_utils.h"
 #include "application.h"
+#include "state_binary.h"
+#include <charconv>
 #include <optional>
 #include <atomic>
 
@@ -11,8 +13,205 @@ namespace http_handler {
     class RequestAPI {
         RequestAPI() = delete;
     public:
+        /// Вынимает токен из заголовка Authorization (или из поля authorization в теле) в Authorization
         template<typename REQUEST_T>
-        static StringResponse process(REQUEST_T&& req, model::Game& game_, const tcp::endpoint& remote_endpoint) {
+        static bool IsBadAuthorization(const REQUEST_T& req, const json_loader::RequestBody& body, std::string& Authorization) {
+            bool bad = true;
+            try {
+                auto AutorizationB = req.at("Authorization"sv);
+                Authorization = std::string(AutorizationB.data(), AutorizationB.size());
+                bad = false;
+            }
+            catch (std::exception&) {
+                try {
+                    auto AutorizationB = req.at("authorization"sv);
+                    Authorization = std::string(AutorizationB.data(), AutorizationB.size());
+                    bad = false;
+                }
+                catch (std::exception&) {}
+            }
+
+            if (body.authorization.has_value()) {
+                Authorization = body.authorization.value();
+                bad = false;
+            }
+
+            if (bad == true) {
+                return true;
+            }
+            const std::string str_bearer("Bearer");
+            auto pos = Authorization.find(str_bearer);
+            if (pos == std::string::npos) {
+                return true;
+            }
+            Authorization = Authorization.erase(0, pos + str_bearer.size());
+            std::erase(Authorization, ' ');
+            if (Authorization.size() != 32) {
+                return true;
+            }
+
+            for (auto& ch : Authorization) {
+                if (std::isxdigit(ch) == false) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /*
+         * Индекс карты, в сессии которой выполняется запрос.
+         * По нему RequestHandler выбирает strand сессии. std::nullopt - запрос глобальный
+         * (/maps, /records, /tick, /join на карту без сессии) или его всё равно отклонят при проверке токена.
+         * GET/HEAD /state и /players strand не нужен: см. IsSnapshotRead.
+         */
+        /// Чтение из опубликованного снимка сессии и списка игроков: выполняется в любом потоке без strand-а
+        template<typename REQUEST_T>
+        static bool IsSnapshotRead(ApiRoute route, const REQUEST_T& req) {
+            if (req.method() != http::verb::get && req.method() != http::verb::head) {
+                return false;
+            }
+            return route == ApiRoute::STATE || route == ApiRoute::PLAYERS;
+        }
+
+        template<typename REQUEST_T>
+        static std::optional<Map::Index> FindSessionIndex(ApiRoute route, const REQUEST_T& req, const json_loader::RequestBody& body, model::Game& game_) {
+            if (route == ApiRoute::JOIN || route == ApiRoute::JOIN_BULK) {
+                if (body.map_id == std::nullopt) {
+                    return std::nullopt;
+                }
+                auto mapIndex = game_.FindMapIndex(Map::Id(body.map_id.value()));
+                if (mapIndex == std::nullopt || game_.FindSession(mapIndex.value()) == nullptr) {
+                    return std::nullopt;
+                }
+                return mapIndex;
+            }
+            if (route == ApiRoute::ACTION) {
+                std::string Authorization;
+                if (IsBadAuthorization(req, body, Authorization)) {
+                    return std::nullopt;
+                }
+                auto player = Players::FindPlayerByToken(TokenFromString(Authorization));
+                if (player == std::nullopt || player.value()->GetSession() == nullptr) {
+                    return std::nullopt;
+                }
+                return player.value()->GetSession()->GetMap()->GetIndex();
+            }
+            return std::nullopt;
+        }
+
+        /// Сколько игроков можно добавить одним /join/bulk
+        constexpr static std::size_t max_bulk_join = 10000;
+
+        /// Верхняя граница ожидания waitForTick: в режиме /tick тика может не быть вовсе
+        constexpr static std::chrono::milliseconds max_tick_wait{ 10000 };
+
+        /// std::nullopt - параметр есть, но это не число; вложенный std::nullopt - параметра нет
+        static std::optional<std::optional<std::uint64_t>> ParseTickParam(std::string_view target, std::string_view name) {
+            auto param = FindQueryParam(target, name);
+            if (param == std::nullopt) {
+                return std::optional<std::uint64_t>{};
+            }
+            if (param->empty() || param->size() > 19 ||
+                !std::all_of(param->begin(), param->end(), [](unsigned char ch) { return std::isdigit(ch); })) {
+                return std::nullopt;
+            }
+            return std::optional<std::uint64_t>{ std::stoull(param.value()) };
+        }
+
+        /*
+         * GET/HEAD /state?waitForTick=N, когда у сессии игрока ещё нет снимка с тиком N:
+         * сессия и последний опубликованный тик. Запрос паркуется до следующего тика,
+         * поэтому N дальше следующего тика ждёт только его. Иначе std::nullopt - отвечаем сразу
+         * (в том числе ошибкой: её вернёт process).
+         */
+        template<typename REQUEST_T>
+        static std::optional<std::pair<GameSessionSharedPtr, std::uint64_t>> FindTickWait(ApiRoute route, const REQUEST_T& req, const json_loader::RequestBody& body) {
+            if (route != ApiRoute::STATE) {
+                return std::nullopt;
+            }
+            std::string target = FromUrlEncoding(static_cast<std::string>(req.target()));
+            auto wait_for = ParseTickParam(target, "waitForTick"sv);
+            if (wait_for == std::nullopt || wait_for->has_value() == false) {
+                return std::nullopt;
+            }
+            std::string Authorization;
+            if (IsBadAuthorization(req, body, Authorization)) {
+                return std::nullopt;
+            }
+            auto player = Players::FindPlayerByToken(TokenFromString(Authorization));
+            if (player == std::nullopt || player.value()->GetSession() == nullptr) {
+                return std::nullopt;
+            }
+            auto session = player.value()->GetSession();
+            auto tick = session->GetSnapshot()->tick;
+            if (tick >= wait_for->value()) {
+                return std::nullopt;
+            }
+            return std::make_pair(session, tick);
+        }
+
+        /// Отказ admission control: 503 с Retry-After, запрос не обрабатывался
+        template<typename REQUEST_T>
+        static StringResponse MakeServiceUnavailable(const REQUEST_T& req, std::chrono::seconds retry_after) {
+            auto begin = std::chrono::high_resolution_clock::now();
+            std::string body = json_loader::ToJsonAsString(FreqStr::code, "serviceUnavailable"sv,
+                                                           FreqStr::message, "Server is overloaded, retry later"sv);
+            auto response = ResponseUtils::MakeResponse<StringResponse>(
+                http::status::service_unavailable,
+                body,
+                body.size(),
+                req.version(),
+                req.keep_alive(),
+                std::make_pair(http::field::content_type, ContentType::APPLICATION_JSON),
+                std::make_pair(http::field::cache_control, FreqStr::no_cache),
+                std::make_pair(http::field::retry_after, std::string_view(std::to_string(retry_after.count()))));
+            LogResponse(response, begin, "request shed"s);
+            return response;
+        }
+
+        /// Ответ на запрос, обработка которого упала: клиент и очередь ответов соединения не ждут до таймаута
+        static StringResponse MakeInternalError(unsigned http_version, bool keep_alive) {
+            auto begin = std::chrono::high_resolution_clock::now();
+            std::string body = json_loader::ToJsonAsString(FreqStr::code, "internalError"sv,
+                                                           FreqStr::message, "Internal server error"sv);
+            auto response = ResponseUtils::MakeResponse<StringResponse>(
+                http::status::internal_server_error,
+                body,
+                body.size(),
+                http_version,
+                keep_alive,
+                std::make_pair(http::field::content_type, ContentType::APPLICATION_JSON),
+                std::make_pair(http::field::cache_control, FreqStr::no_cache));
+            LogResponse(response, begin, "request failed"s);
+            return response;
+        }
+
+        /// Ответ /admission: очереди strand-ов API и число отказов 503
+        template<typename REQUEST_T>
+        static StringResponse MakeAdmissionReport(const REQUEST_T& req, const util::AdmissionStats& stats) {
+            auto begin = std::chrono::high_resolution_clock::now();
+            std::string body = json_loader::GetAdmissionCase(stats);
+            auto response = ResponseUtils::MakeResponse<StringResponse>(
+                http::status::ok,
+                body,
+                body.size(),
+                req.version(),
+                req.keep_alive(),
+                std::make_pair(http::field::content_type, ContentType::APPLICATION_JSON),
+                std::make_pair(http::field::cache_control, FreqStr::no_cache));
+            LogResponse(response, begin, "response sent"s);
+            return response;
+        }
+
+        /*
+         * Ответ отдаётся через send. Обычно это происходит до возврата из process,
+         * но ответ на /join уходит из потока тика, когда команда добавления игрока выполнена.
+         */
+        template<typename REQUEST_T, typename Send>
+        static void process(ApiRoute route, REQUEST_T&& req, const json_loader::RequestBody& body_fields,
+                            model::Game& game_, const json_loader::MapResponses& map_responses,
+                            const tcp::endpoint& remote_endpoint, Send&& send) {
             auto begin = std::chrono::high_resolution_clock::now();
             LOG(LOG::MESSAGE_DATA)
                 << "request received"sv
@@ -51,6 +250,113 @@ namespace http_handler {
                         std::make_pair(http::field::cache_control, FreqStr::no_cache));
             };
 
+             /// сжатие выбирается один раз на запрос; сжатые представления общих тел кешируются рядом с ними
+             const auto encoding = http_compression::Negotiate(req[http::field::accept_encoding]);
+
+             /// общее тело (снимок сессии, карты) уходит без копирования, поэтому ответ отправляется сразу, минуя response.
+             /// encoded - то же тело в кодировке encoding, nullptr - тело уходит несжатым
+             auto send_shared_body = [&](const SessionSnapshot::Body& body, const SessionSnapshot::Body& encoded,
+                                         std::string_view etag, std::string_view content_type) {
+                 const auto& sent = encoded != nullptr ? encoded : body;
+                 auto shared_response = ResponseUtils::MakeResponse<SharedResponse>(
+                     http::status::ok,
+                     req.method() == http::verb::get ? sent : SessionSnapshot::Body{},
+                     sent->size(),
+                     http_version,
+                     keep_alive,
+                     std::make_pair(http::field::content_type, content_type),
+                     std::make_pair(http::field::cache_control, FreqStr::no_cache));
+                 if (encoded != nullptr) {
+                     shared_response.set(http::field::content_encoding, http_compression::ToString(encoding));
+                     shared_response.set(http::field::etag, EncodedETag(etag, encoding));
+                 }
+                 else {
+                     shared_response.set(http::field::etag, etag);
+                 }
+                 /// тела /state и /players зависят от токена: сессия игрока, его собака для области интереса
+                 shared_response.set(http::field::vary, route == ApiRoute::STATE   ? "Accept, Accept-Encoding, Authorization"sv
+                                                      : route == ApiRoute::PLAYERS ? "Accept-Encoding, Authorization"sv
+                                                                                   : "Accept-Encoding"sv);
+                 LogResponse(shared_response, begin, "response sent"s);
+                 send(std::move(shared_response));
+             };
+
+             /// true - клиент прислал If-None-Match с этим etag или с etag его сжатого представления, ответ 304 уже отправлен
+             auto send_not_modified_etag = [&](std::string_view etag)->bool {
+                 auto if_none_match = req[http::field::if_none_match];
+                 if (if_none_match.empty()) {
+                     return false;
+                 }
+                 std::string matched;
+                 if (IfNoneMatch(if_none_match, etag)) {
+                     matched = etag;
+                 }
+                 else if (encoding != http_compression::Encoding::IDENTITY) {
+                     if (auto encoded_etag = EncodedETag(etag, encoding); IfNoneMatch(if_none_match, encoded_etag)) {
+                         matched = std::move(encoded_etag);
+                     }
+                 }
+                 if (matched.empty()) {
+                     return false;
+                 }
+                 StringResponse not_modified(http::status::not_modified, http_version);
+                 not_modified.keep_alive(keep_alive);
+                 not_modified.set(http::field::etag, matched);
+                 not_modified.set(http::field::cache_control, FreqStr::no_cache);
+                 LogResponse(not_modified, begin, "response sent"s);
+                 send(std::move(not_modified));
+                 return true;
+             };
+
+             /// Сжатое представление body или nullptr, если клиент не принимает сжатие или оно не уменьшает тело.
+             /// compress() возвращает сжатое тело: для тел из кеша снимка оно сжимается один раз на тик
+             auto encode_body = [&](const SessionSnapshot::Body& body, auto&& compress)->SessionSnapshot::Body {
+                 if (encoding == http_compression::Encoding::IDENTITY || body->size() < http_compression::min_size) {
+                     return nullptr;
+                 }
+                 SessionSnapshot::Body encoded = compress();
+                 return encoded->size() < body->size() ? encoded : nullptr;
+             };
+
+             /// Тело, построенное для одного запроса (область интереса, старый sinceTick): JSON, сжимается на месте
+             auto send_snapshot_body = [&](const SessionSnapshot::Body& body, std::string_view etag) {
+                 auto encoded = encode_body(body, [&] {
+                     return std::make_shared<const std::string>(http_compression::Compress(*body, encoding, http_compression::level_per_tick));
+                 });
+                 send_shared_body(body, encoded, etag, ContentType::APPLICATION_JSON);
+             };
+
+             /// Тело из кеша снимка: и сериализация, и сжатие выполняются один раз на тик для всех клиентов.
+             /// binary - тело в формате state_binary.h
+             auto send_cached_snapshot_body = [&](const SessionSnapshot& snapshot, SessionSnapshot::CachedBody which,
+                                                  auto&& make, std::string_view etag, bool binary = false) {
+                 auto body = snapshot.GetBody(which, make);
+                 auto encoded = encode_body(body, [&] {
+                     return snapshot.GetBody(which, static_cast<std::size_t>(encoding), [&] {
+                         return http_compression::Compress(*body, encoding, http_compression::level_per_tick);
+                     });
+                 });
+                 send_shared_body(body, encoded, etag, binary ? ContentType::BINARY_DATA : ContentType::APPLICATION_JSON);
+             };
+
+             /// ETag ответа из снимка: тик, сессия и само представление (формат, sinceTick, область интереса).
+             /// Пока тик не сменился, клиент с If-None-Match получает 304 без сериализации, но только для того же тела
+             auto make_snapshot_etag = [](const SessionSnapshot& snapshot, const model::GameSession& session, std::string_view representation) {
+                 std::string variant = "s"s + std::to_string(session.GetId());
+                 if (!representation.empty()) {
+                     variant.append("-").append(representation);
+                 }
+                 return MakeTickETag(snapshot.tick, variant);
+             };
+
+             /// ответ /maps и /maps/{id}, построенный и сжатый при запуске
+             auto send_map_response = [&](const json_loader::MapResponses::Response& map_response) {
+                 if (!send_not_modified_etag(map_response.etag)) {
+                     send_shared_body(map_response.body, map_response.encoded[static_cast<std::size_t>(encoding)],
+                                      map_response.etag, ContentType::APPLICATION_JSON);
+                 }
+             };
+
              auto make_response_error_405 = [&](std::string_view allowed_methods, std::string_view target_)->StringResponse 
              {       
                  std::string message = "Only ";
@@ -68,76 +374,18 @@ namespace http_handler {
                      std::make_pair(http::field::cache_control, FreqStr::no_cache));
              };
 
-             auto this_is_bad_autorization = [&req](std::string& Authorization) {
-                 bool bad = true;
-                 try {
-                     auto AutorizationB = req.at("Authorization"sv);
-                     Authorization = std::string(AutorizationB.data(), AutorizationB.size());
-                     bad = false;
-                 }
-                 catch (std::exception&) {
-                     try {
-                         auto AutorizationB = req.at("authorization"sv);
-                         Authorization = std::string(AutorizationB.data(), AutorizationB.size());
-                         bad = false;
-                     }
-                     catch (std::exception&) {}
-                 }
-
-                 std::string b = req.body();
-
-                 if (json_loader::isJsonValid(b) && b.find("authorization"sv) != std::string::npos) {
-                     Authorization = json_loader::GetValueAsString(b, "authorization"s);
-                     bad = false;
-                 }
-                 else if (json_loader::isJsonValid(b) && b.find("Authorization"sv) != std::string::npos) {
-                     Authorization = json_loader::GetValueAsString(b, "Authorization"s);
-                     bad = false;
-                 }
-
-                 if (bad == true) {
-                     return true;
-                 }
-                 const std::string str_bearer("Bearer");
-                 auto pos = Authorization.find(str_bearer);
-                 if (pos == std::string::npos) {
-                     return true;
-                 }
-                 Authorization = Authorization.erase(0, pos + str_bearer.size());
-                 std::erase(Authorization, ' ');
-                 if (Authorization.size() != 32) {
-                     return true;
-                 }
-
-                 for (auto& ch : Authorization) {
-                     if (std::isxdigit(ch) == false) {
-                         return true;
-                     }
-                 }
-
-                 return false;
+             auto this_is_bad_autorization = [&req, &body_fields](std::string& Authorization) {
+                 return IsBadAuthorization(req, body_fields, Authorization);
              };
 
-            std::string target = FromUrlEncoding(static_cast<std::string>(req.target()));
-            auto target_is = [&target](std::string_view target_)->bool {
-                return target == target_;
-            };
-
-            auto target_is_records = [&target]()->bool {
-                std::string str(TargetAPI::TARGET_RECORDS);
-                return target.find(str) != std::string::npos;
-                
-            };
-
-            auto target_is_single_map = [&target]()->bool {
-                std::string str(TargetAPI::TARGET_MAPS);
-                return target.find(str + "/") != std::string::npos;
-            };
+            const ApiRouteInfo& route_info = ApiRoutes::Info(route);
+            /// путь уже разобран таблицей маршрутов: декодировать target нужно только ради строки запроса или имени карты
+            std::string target = route_info.reads_target ? FromUrlEncoding(static_cast<std::string>(req.target())) : std::string{};
 
-            auto target_is_game_join = [&target,&req]()->bool {
+            auto target_is_game_join = [route, &req, &body_fields]()->bool {
                 bool is_application_json; 
-                bool have_userName_and_mapId=json_loader::isJsonHaveKeys(req.body(),"userName"s,"mapId"s); 
-                bool is_target_game_join = (target == TargetAPI::TARGET_JOIN);
+                bool have_userName_and_mapId = body_fields.user_name.has_value() && body_fields.map_id.has_value();
+                bool is_target_game_join = (route == ApiRoute::JOIN);
 
                 try{
                     auto content_type_req = req.at(http::field::content_type);
@@ -155,10 +403,10 @@ namespace http_handler {
                 return is_application_json && have_userName_and_mapId && is_target_game_join;
             };
 
-            auto target_is_action = [&target, &req]()->bool {
+            auto target_is_action = [route, &req, &body_fields]()->bool {
                 bool is_application_json;
-                bool have_move = json_loader::isJsonHaveKeys(req.body(), "move"s);
-                bool is_target_action = (target == TargetAPI::TARGET_ACTION);
+                bool have_move = body_fields.move.has_value();
+                bool is_target_action = (route == ApiRoute::ACTION);
 
                 try {
                     auto content_type_req = req.at(http::field::content_type);
@@ -176,10 +424,10 @@ namespace http_handler {
                 return is_application_json && have_move && is_target_action;
             };
 
-            auto target_is_tick = [&target, &req]()->bool {
+            auto target_is_tick = [route, &req, &body_fields]()->bool {
                 bool is_application_json;
-                bool have_timeDelta = json_loader::isJsonHaveKeys(req.body(), "timeDelta"s);
-                bool is_target_tick = (target == TargetAPI::TARGET_TICK);
+                bool have_timeDelta = body_fields.has_time_delta;
+                bool is_target_tick = (route == ApiRoute::TICK);
 
                 try {
                     auto content_type_req = req.at(http::field::content_type);
@@ -197,6 +445,43 @@ namespace http_handler {
                 return is_application_json && have_timeDelta && is_target_tick;
             };
 
+            auto parse_tick_param = [&target](std::string_view name) {
+                return ParseTickParam(target, name);
+            };
+
+            /// std::nullopt - параметр есть, но это не положительное число; вложенный std::nullopt - параметра нет
+            auto parse_aoi_radius = [&target]()->std::optional<std::optional<Double>> {
+                auto param = FindQueryParam(target, "aoiRadius"sv);
+                if (param == std::nullopt) {
+                    return std::optional<Double>{};
+                }
+                try {
+                    std::size_t parsed = 0;
+                    Double radius = std::stod(param.value(), &parsed);
+                    if (parsed != param->size() || !std::isfinite(radius) || radius <= 0.) {
+                        return std::nullopt;
+                    }
+                    return std::optional<Double>{ radius };
+                }
+                catch (std::exception&) {
+                    return std::nullopt;
+                }
+            };
+
+            /// std::nullopt - неизвестный format. Двоичный ответ - по format=binary или Accept: application/octet-stream
+            auto parse_state_format = [&target, &req]()->std::optional<bool> {
+                if (auto format = FindQueryParam(target, "format"sv)) {
+                    if (format == "binary"sv) {
+                        return true;
+                    }
+                    if (format == "json"sv) {
+                        return false;
+                    }
+                    return std::nullopt;
+                }
+                return req[http::field::accept].find(ContentType::BINARY_DATA) != std::string_view::npos;
+            };
+
             auto get_single_map_name = [&target]()->std::string {
                 return  target.erase(0, target.rfind("/") + 1);
             };
@@ -206,13 +491,10 @@ namespace http_handler {
             case http::verb::get:
             case http::verb::head:
             {
-                if (target_is(TargetAPI::TARGET_JOIN)) {
-                    response = make_response_error_405(ResponseAllowedMethods::POST, TargetAPI::TARGET_JOIN);
-                }
-                else if (target_is(TargetAPI::TARGET_TICK)) {
-                    response = make_response_error_405(ResponseAllowedMethods::POST, TargetAPI::TARGET_TICK);
+                if (!route_info.Allows(verb)) {
+                    response = make_response_error_405(route_info.allow, route_info.name);
                 }
-                else if (target_is(TargetAPI::TARGET_PLAYERS)) {
+                else if (route == ApiRoute::PLAYERS) {
                     std::string Authorization;
 
                     if (this_is_bad_autorization(Authorization)) {
@@ -220,57 +502,114 @@ namespace http_handler {
                                                                        FreqStr::message, "Error: Authorization header is wrong"sv);
                         response = make_response_error(http::int_to_status(401u), body, body.size());
                     }
-                    else if (Players::FindPlayerByToken(Token(Authorization)) == std::nullopt) {
+                    else if (auto player = Players::FindPlayerByToken(TokenFromString(Authorization)); player == std::nullopt) {
                         std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::unknownToken,
                                                                        FreqStr::message, "Error: Player token has not been found"sv);
                         response = make_response_error(http::int_to_status(401u), body, body.size());
                     }
                     else {//if everething is ok
-                        Token token(Authorization);
-                        std::string body = json_loader::GetPlayersCase(Players::FindPlayersInSessionWithToken(token));
-                        response = ResponseUtils::MakeResponse<StringResponse>(
-                            http::status::ok,
-                            verb == http::verb::get ? body : ""sv,
-                            body.size(),
-                            http_version,
-                            keep_alive,
-                            std::make_pair(http::field::content_type, ContentType::APPLICATION_JSON),
-                            std::make_pair(http::field::cache_control, FreqStr::no_cache));
+                        auto snapshot = player.value()->GetSession()->GetSnapshot();
+                        const auto etag = make_snapshot_etag(*snapshot, *player.value()->GetSession(), "players"sv);
+                        if (send_not_modified_etag(etag)) {
+                            return;
+                        }
+                        send_cached_snapshot_body(*snapshot, SessionSnapshot::CachedBody::PLAYERS, [&snapshot] {
+                            return json_loader::GetPlayersCase(*snapshot);
+                        }, etag);
+                        return;
                     }
                 }
-                else if (target_is(TargetAPI::TARGET_STATE)) {
+                else if (route == ApiRoute::STATE) {
                     std::string Authorization;
                     if (this_is_bad_autorization(Authorization)) {
                         std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::invalidToken,
                             FreqStr::message, "Error: Authorization header is wrong"sv);
                         response = make_response_error(http::int_to_status(401u), body, body.size());
                     }
-                    else if (Players::FindPlayerByToken(Token(Authorization)) == std::nullopt) {
+                    else if (auto player = Players::FindPlayerByToken(TokenFromString(Authorization)); player == std::nullopt) {
                         std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::unknownToken,
                             FreqStr::message, "Error: Player token has not been found"sv);
                         response = make_response_error(http::int_to_status(401u), body, body.size());
                     }
+                    else if (auto since = parse_tick_param("sinceTick"sv); since == std::nullopt) {
+                        std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::invalidArgument,
+                            FreqStr::message, "Error: sinceTick must be a tick number"sv);
+                        response = make_response_error(http::int_to_status(400u), body, body.size());
+                    }
+                    else if (parse_tick_param("waitForTick"sv) == std::nullopt) {
+                        std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::invalidArgument,
+                            FreqStr::message, "Error: waitForTick must be a tick number"sv);
+                        response = make_response_error(http::int_to_status(400u), body, body.size());
+                    }
+                    else if (auto radius = parse_aoi_radius(); radius == std::nullopt || (radius->has_value() && since->has_value())) {
+                        std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::invalidArgument,
+                            FreqStr::message, "Error: aoiRadius must be a positive number and cannot be combined with sinceTick"sv);
+                        response = make_response_error(http::int_to_status(400u), body, body.size());
+                    }
+                    else if (auto format = parse_state_format(); format == std::nullopt) {
+                        std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::invalidArgument,
+                            FreqStr::message, "Error: format must be json or binary"sv);
+                        response = make_response_error(http::int_to_status(400u), body, body.size());
+                    }
                     else {//if everething is ok
-                        Token token(Authorization);
-                        std::string body = json_loader::GetStateCase(Players::FindPlayersInSessionWithToken(token),
-                                                                     Players::FindLootsInSessionWithPlayerToken(token));
-                        response = ResponseUtils::MakeResponse<StringResponse>(
-                            http::status::ok,
-                            verb == http::verb::get ? body : ""sv,
-                            body.size(),
-                            http_version,
-                            keep_alive,
-                            std::make_pair(http::field::content_type, ContentType::APPLICATION_JSON),
-                            std::make_pair(http::field::cache_control, FreqStr::no_cache));
+                        /// ожидание waitForTick уже прошло в RequestHandler (см. FindTickWait): отдаём то, что есть
+                        auto snapshot = player.value()->GetSession()->GetSnapshot();
+                        /// двоичное представление есть только у полного состояния; с sinceTick и aoiRadius ответ - JSON
+                        const bool binary = format.value() && !since->has_value() && !radius->has_value();
+                        /// область интереса: только то, что рядом с собакой игрока, выборка по сеткам снимка.
+                        /// Собаки ещё нет в снимке - отдаём полное состояние
+                        const auto* aoi_dog = radius->has_value() ? snapshot->FindDog(player.value()->GetDog()->GetId()) : nullptr;
+                        const auto since_tick = since.value();
+
+                        std::string representation;
+                        if (binary) {
+                            representation = "bin"s;
+                        }
+                        else if (aoi_dog != nullptr) {
+                            /// радиус кратчайшей записью, которая читается обратно в то же число
+                            char radius_chars[32];
+                            auto radius_end = std::to_chars(radius_chars, radius_chars + sizeof(radius_chars), radius->value()).ptr;
+                            representation = "aoi"s + std::to_string(aoi_dog->id) + "r"s;
+                            representation.append(radius_chars, radius_end);
+                        }
+                        else if (since_tick.has_value()) {
+                            representation = "since"s + std::to_string(since_tick.value());
+                        }
+                        const auto etag = make_snapshot_etag(*snapshot, *player.value()->GetSession(), representation);
+                        if (send_not_modified_etag(etag)) {
+                            return;
+                        }
+
+                        if (binary) {
+                            send_cached_snapshot_body(*snapshot, SessionSnapshot::CachedBody::STATE_BINARY, [&snapshot] {
+                                return state_binary::Encode(*snapshot);
+                            }, etag, true);
+                        }
+                        else if (aoi_dog != nullptr) {
+                            send_snapshot_body(std::make_shared<const std::string>(
+                                json_loader::GetStateAroundCase(*snapshot, aoi_dog->position, radius->value())), etag);
+                        }
+                        else if (since_tick == std::nullopt) {
+                            send_cached_snapshot_body(*snapshot, SessionSnapshot::CachedBody::STATE, [&snapshot] {
+                                return json_loader::GetStateCase(*snapshot);
+                            }, etag);
+                        }
+                        else if (since_tick.value() + 1 == snapshot->tick) {
+                            send_cached_snapshot_body(*snapshot, SessionSnapshot::CachedBody::STATE_SINCE_PREVIOUS_TICK, [&snapshot, &since_tick] {
+                                return json_loader::GetStateSinceCase(*snapshot, since_tick.value());
+                            }, etag);
+                        }
+                        else {
+                            send_snapshot_body(std::make_shared<const std::string>(json_loader::GetStateSinceCase(*snapshot, since_tick.value())), etag);
+                        }
+                        return;
                     }
                 }
-                else if (target_is(TargetAPI::TARGET_MAPS)) {
-                    std::string body = json_loader::GetMapsList(game_);
-                    response = make_response_json(http::status::ok,
-                        verb == http::verb::get ? body : ""sv,
-                        body.size());
+                else if (route == ApiRoute::MAPS) {
+                    send_map_response(map_responses.GetList());
+                    return;
                 }
-                else if (target_is_records()) {
+                else if (route == ApiRoute::RECORDS) {
                      auto ParseToPair = [](const std::string& str) {
                          std::optional<std::pair<std::string, std::string>> result;
                          
@@ -343,12 +682,10 @@ namespace http_handler {
                             body.size());
                     }
                 }
-                else if (target_is_single_map()) {
-                    auto body = json_loader::GetMap(game_, get_single_map_name());
-                    if (body != std::nullopt) {
-                        response = make_response_json(http::status::ok,
-                            verb == http::verb::get ? body.value() : ""sv,
-                            body.value().size());
+                else if (route == ApiRoute::SINGLE_MAP) {
+                    if (const auto* map_response = map_responses.Find(get_single_map_name())) {
+                        send_map_response(*map_response);
+                        return;
                     }
                     else {
                         std::string body = json_loader::MakeError("mapNotFound"s, "Map not found"s);
@@ -359,23 +696,17 @@ namespace http_handler {
             } 
             case http::verb::post:
             {
-                if (target_is(TargetAPI::TARGET_PLAYERS)) {
-                    response = make_response_error_405(ResponseAllowedMethods::GET_HEAD, TargetAPI::TARGET_PLAYERS);
-                }
-                else if (target_is(TargetAPI::TARGET_STATE)) {
-                    response = make_response_error_405(ResponseAllowedMethods::GET_HEAD, TargetAPI::TARGET_STATE);
-                }
-                else if (target_is_single_map()) {
-                    response = make_response_error_405(ResponseAllowedMethods::GET_HEAD, "/maps/{map_id}");
+                if (!route_info.Allows(verb)) {
+                    response = make_response_error_405(route_info.allow, route_info.name);
                 }
                 else if (target_is_tick()) {
-                    auto timeDelta = json_loader::GetValueAsUInt64(req.body(), "timeDelta");
+                    auto timeDelta = body_fields.time_delta;
                     if (game_.GetTickPeriod() != Game::TICK_TESTING_MODE) {
                         std::string body = json_loader::ToJsonAsString(FreqStr::code, "badRequest"sv,
                                                                        FreqStr::message, "Error: server was launched with --tick_period. Now the server decides when the tick will occur."sv);
                         response = make_response_error(http::int_to_status(400u), body, body.size());
                     }
-                    else if ((json_loader::isJsonValid(req.body()) == false) || (timeDelta.has_value() == false)) {
+                    else if ((body_fields.is_json == false) || (timeDelta.has_value() == false)) {
                         std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::invalidArgument,
                                   FreqStr::message, "Error in parsing JSON or timeDelta field is error"sv);
                         response = make_response_error(http::int_to_status(400u), body, body.size());
@@ -395,7 +726,7 @@ namespace http_handler {
                 }
                 else if (target_is_action()) {
                     std::string Authorization;
-                    std::string move = json_loader::GetValueAsString(req.body(), "move");
+                    std::string move = body_fields.move.value_or(""s);
 
                     auto is_move_valid = [&move] {
                         if (move == "L" ||
@@ -413,19 +744,22 @@ namespace http_handler {
                             FreqStr::message, "Error: Authorization header is wrong"sv);
                         response = make_response_error(http::int_to_status(401u), body, body.size());
                     }
-                    else if (Players::FindPlayerByToken(Token(Authorization)) == std::nullopt) {
+                    else if (Players::FindPlayerByToken(TokenFromString(Authorization)) == std::nullopt) {
                         std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::unknownToken,
                             FreqStr::message, "Error: Player token has not been found"sv);
                         response = make_response_error(http::int_to_status(401u), body, body.size());
                     }
-                    else if ((json_loader::isJsonValid(req.body()) == false) && is_move_valid()) {
+                    else if ((body_fields.is_json == false) && is_move_valid()) {
                         std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::invalidArgument,
                             FreqStr::message, "Error in parsing JSON or move field is wrong"sv);
                         response = make_response_error(http::int_to_status(400u), body, body.size());
                     }
                     else {//if everething is ok
-                        Token token(Authorization);
-                        Players::FindPlayerByToken(token).value()->DoAction(ACTIONS::MOVE, move);
+                        Token token = TokenFromString(Authorization);
+                        auto player = Players::FindPlayerByToken(token).value();
+                        game_.Submit([player, move] {
+                            player->DoAction(ACTIONS::MOVE, move);
+                        });
                         std::string body = "{}";
                         response = ResponseUtils::MakeResponse<StringResponse>(
                             http::status::ok,
@@ -437,11 +771,111 @@ namespace http_handler {
                             std::make_pair(http::field::cache_control, FreqStr::no_cache));
                     }
                 }
+                else if (route == ApiRoute::ACTIONS) {
+                    if (const auto& batch = body_fields.batch_actions; batch == std::nullopt) {
+                        std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::invalidArgument,
+                            FreqStr::message, "Error: expected {\"actions\": [{\"token\": ..., \"move\": ...}, ...]}"sv);
+                        response = make_response_error(http::int_to_status(400u), body, body.size());
+                    }
+                    else {//if everething is ok
+                        /// все принятые действия уходят в игру одной командой
+                        std::vector<std::pair<PlayerSharedPtr, std::string>> accepted;
+                        accepted.reserve(batch->actions.size());
+                        std::vector<std::string_view> codes;
+                        codes.reserve(batch->actions.size());
+                        std::vector<GameSessionSharedPtr> sessions;
+                        for (const auto& [token, move] : batch->actions) {
+                            if (move != "L" && move != "R" && move != "U" && move != "D" && move != "") {
+                                codes.push_back(FreqStr::invalidArgument);
+                                continue;
+                            }
+                            std::optional<PlayerSharedPtr> player;
+                            try {
+                                player = Players::FindPlayerByToken(TokenFromString(token));
+                            }
+                            catch (std::invalid_argument&) {
+                                codes.push_back(FreqStr::invalidToken);
+                                continue;
+                            }
+                            if (player == std::nullopt || player.value()->GetSession() == nullptr) {
+                                codes.push_back(FreqStr::unknownToken);
+                                continue;
+                            }
+                            codes.push_back(""sv);
+                            if (batch->with_state &&
+                                std::find(sessions.begin(), sessions.end(), player.value()->GetSession()) == sessions.end()) {
+                                sessions.push_back(player.value()->GetSession());
+                            }
+                            accepted.emplace_back(player.value(), move);
+                        }
+                        if (!accepted.empty()) {
+                            game_.Submit([accepted = std::move(accepted)] {
+                                for (const auto& [player, move] : accepted) {
+                                    player->DoAction(ACTIONS::MOVE, move);
+                                }
+                            });
+                        }
+
+                        /// состояние - из последнего опубликованного снимка, действия этого запроса в него ещё не вошли
+                        std::vector<std::pair<std::string_view, SessionSnapshot::Body>> states;
+                        states.reserve(sessions.size());
+                        for (const auto& session : sessions) {
+                            auto snapshot = session->GetSnapshot();
+                            states.emplace_back(*session->GetMap()->GetId(), snapshot->GetBody(SessionSnapshot::CachedBody::STATE, [&snapshot] {
+                                return json_loader::GetStateCase(*snapshot);
+                            }));
+                        }
+                        std::string body = json_loader::GetBatchActionsCase(codes, states);
+                        response = make_response_json(http::status::ok, body, body.size());
+                    }
+                }
+                else if (route == ApiRoute::JOIN_BULK) {
+                    const auto& user_names = body_fields.user_names;
+                    if (user_names == std::nullopt || body_fields.map_id == std::nullopt) {
+                        std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::invalidArgument,
+                            FreqStr::message, "Error: expected {\"mapId\": ..., \"userNames\": [...]}"sv);
+                        response = make_response_error(http::int_to_status(400u), body, body.size());
+                    }
+                    else if (user_names->empty() || user_names->size() > max_bulk_join) {
+                        std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::invalidArgument,
+                            FreqStr::message, "Error: userNames must hold 1.." + std::to_string(max_bulk_join) + " names");
+                        response = make_response_error(http::int_to_status(400u), body, body.size());
+                    }
+                    else if (std::any_of(user_names->begin(), user_names->end(), [](const std::string& name) { return name.empty(); })) {
+                        std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::invalidArgument,
+                            FreqStr::message, "Error in recived JSON: userName is empty"sv);
+                        response = make_response_error(http::int_to_status(400u), body, body.size());
+                    }
+                    else if (auto mapIndex = game_.FindMapIndex(Map::Id(body_fields.map_id.value())); mapIndex == std::nullopt) {
+                        std::string body(json_loader::ToJsonAsString(FreqStr::code, "mapNotFound"sv,
+                            FreqStr::message, "Map not found"sv));
+                        response = make_response_error(http::int_to_status(404u), body, body.size());
+                    }
+                    else {//if everything is ok
+                        /// вся пачка - одна команда: один проход по карте и одна блокировка списка игроков
+                        game_.Submit([&game_, user_names = user_names.value(), mapIndex, http_version, keep_alive, encoding, begin, send] {
+                            auto newPlayers = Players::AddPlayers(game_, user_names, mapIndex.value());
+                            std::string body = json_loader::GetBulkJoinCase(newPlayers);
+                            auto join_response = ResponseUtils::MakeResponse<StringResponse>(
+                                http::status::ok,
+                                body,
+                                body.size(),
+                                http_version,
+                                keep_alive,
+                                std::make_pair(http::field::content_type, ContentType::APPLICATION_JSON),
+                                std::make_pair(http::field::cache_control, FreqStr::no_cache));
+                            CompressResponse(join_response, encoding);
+                            LogResponse(join_response, begin, "response sent"s);
+                            send(std::move(join_response));
+                        });
+                        return;
+                    }
+                }
                 else if (target_is_game_join()) {
-                    Map::Id mapId(json_loader::GetValueAsString(req.body(), "mapId"));
-                    std::string userName = json_loader::GetValueAsString(req.body(), "userName");
+                    Map::Id mapId(body_fields.map_id.value_or(""s));
+                    std::string userName = body_fields.user_name.value_or(""s);
 
-                    if(json_loader::isJsonValid(req.body()) == false){
+                    if(body_fields.is_json == false){
                         std::string body = json_loader::ToJsonAsString(FreqStr::code, FreqStr::invalidArgument,
                                                                        FreqStr::message, "Error in parsing JSON"sv);
                         response = make_response_error(http::int_to_status(400u), body, body.size());
@@ -451,23 +885,28 @@ namespace http_handler {
                                                                        FreqStr::message, "Error in recived JSON: userName is empty"sv);
                         response = make_response_error(http::int_to_status(400u), body, body.size());
                     }
-                    else if (game_.FindMap(mapId) == nullptr) {
+                    else if (auto mapIndex = game_.FindMapIndex(mapId); mapIndex == std::nullopt) {
                         std::string body (json_loader::ToJsonAsString(FreqStr::code, "mapNotFound"sv,
                                                                       FreqStr::message, "Map not found"sv));
                         response = make_response_error(http::int_to_status(404u), body, body.size());
                     }
                     else  {//if everything is ok
-                        std::shared_ptr<Player> newPlayer = Players::AddPlayer(game_, userName, mapId);
-                        std::string body = json_loader::ToJsonAsString("authToken"sv, *newPlayer->GetToken(),
-                                                                       "playerId"sv, newPlayer->GetIdAsUInt64());
-                        response = ResponseUtils::MakeResponse<StringResponse>(
-                            http::status::ok,
-                            body,
-                            body.size(),
-                            http_version,
-                            keep_alive,
-                            std::make_pair(http::field::content_type, ContentType::APPLICATION_JSON),
-                            std::make_pair(http::field::cache_control, FreqStr::no_cache));
+                        game_.Submit([&game_, userName, mapIndex, http_version, keep_alive, begin, send] {
+                            std::shared_ptr<Player> newPlayer = Players::AddPlayer(game_, userName, mapIndex.value());
+                            std::string body = json_loader::ToJsonAsString("authToken"sv, TokenToString(newPlayer->GetToken()),
+                                                                           "playerId"sv, newPlayer->GetIdAsUInt64());
+                            auto join_response = ResponseUtils::MakeResponse<StringResponse>(
+                                http::status::ok,
+                                body,
+                                body.size(),
+                                http_version,
+                                keep_alive,
+                                std::make_pair(http::field::content_type, ContentType::APPLICATION_JSON),
+                                std::make_pair(http::field::cache_control, FreqStr::no_cache));
+                            LogResponse(join_response, begin, "response sent"s);
+                            send(std::move(join_response));
+                        });
+                        return;
                     }
                 }
                 else {
@@ -479,32 +918,28 @@ namespace http_handler {
             }
             default:
             {
-                if (target_is(TargetAPI::TARGET_PLAYERS)) {
-                    response = make_response_error_405(ResponseAllowedMethods::GET_HEAD, TargetAPI::TARGET_PLAYERS);
-                }
-                else if (target_is(TargetAPI::TARGET_STATE)) {
-                    response = make_response_error_405(ResponseAllowedMethods::GET_HEAD, TargetAPI::TARGET_STATE);
-                }
-                else  if (target_is(TargetAPI::TARGET_JOIN)) {
-                    response = make_response_error_405(ResponseAllowedMethods::POST, TargetAPI::TARGET_JOIN);
-                }
-                else  if (target_is(TargetAPI::TARGET_TICK)) {
-                    response = make_response_error_405(ResponseAllowedMethods::POST, TargetAPI::TARGET_TICK);
-                }
-                else if (target_is(TargetAPI::TARGET_ACTION)) {
-                    response = make_response_error_405(ResponseAllowedMethods::GET_HEAD, TargetAPI::TARGET_ACTION);
-                }
-                else if (target_is(TargetAPI::TARGET_RECORDS)) {
-                    response = make_response_error_405(ResponseAllowedMethods::GET_HEAD, TargetAPI::TARGET_RECORDS);
-                }
-                else if (target_is_single_map()) {
-                    response = make_response_error_405(ResponseAllowedMethods::GET_HEAD, "/maps/{map_id}"sv);
-                }
-                else{ ///for all other targets all methods in app expected
-                    response = make_response_error_405(ResponseAllowedMethods::GET_HEAD_POST, "/");
-                }
+                /// остальные методы не разрешены ни одному маршруту
+                response = make_response_error_405(route_info.allow, route_info.name);
             }
             };
+            std::string msg_sent("response sent");
+            if (target_is_tick()) {
+                number_of_ticks++;
+                msg_sent += "(";
+                msg_sent += std::to_string(number_of_ticks.load());
+                msg_sent += ")";
+            }
+            /// ответы, собранные для одного запроса (рекорды, пакеты действий), сжимаются на месте
+            CompressResponse(response, encoding);
+            LogResponse(response, begin, msg_sent);
+            send(std::move(response));
+        };
+
+    private:
+        template<typename ResponseType>
+        static void LogResponse(const ResponseType& response,
+                                std::chrono::high_resolution_clock::time_point begin,
+                                const std::string& msg_sent) {
             auto end = std::chrono::high_resolution_clock::now();
             auto response_time_ms=std::chrono::duration_cast<std::chrono::milliseconds>(end - begin);
             
@@ -518,22 +953,13 @@ namespace http_handler {
             }
             response_code =response.result_int();
 
-            std::string msg_sent("response sent");
-            if (target_is_tick()) {
-                number_of_ticks++;
-                msg_sent += "(";
-                msg_sent += std::to_string(number_of_ticks.load());
-                msg_sent += ")";
-            }
-
             LOG(LOG::MESSAGE_DATA)
                 << msg_sent
                 << LOG::ToJson("response_time"sv, std::to_string(response_time_ms.count()),
                                FreqStr::code, response_code,
                                "content_type"sv, content_type)
                 << LOG::Flush;
-            return response;
-        };
+        }
 
     };
 }///namespace http_handler
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "request_file.h"
 
+#include <fstream>
+#include <iterator>
+
 namespace http_handler {
     std::string_view ContentTypeFromExtention(const std::string& ext) noexcept {
         std::string ext_ = ext;
@@ -14,4 +17,39 @@ namespace http_handler {
         return ContentType::BINARY_DATA;
     }
 
-}
\ No newline at end of file
+    std::mutex CompressedFiles::mutex;
+    std::map<std::pair<std::string, http_compression::Encoding>, CompressedFiles::Entry> CompressedFiles::cache;
+
+    SharedStringBody::value_type CompressedFiles::Get(const std::string& path, http_compression::Encoding encoding) {
+        std::error_code ec;
+        const auto write_time = fs::last_write_time(path, ec);
+        const auto size = ec ? 0 : fs::file_size(path, ec);
+        if (ec || size < http_compression::min_size || size > max_file_size) {
+            return nullptr;
+        }
+
+        auto key = std::make_pair(path, encoding);
+        {
+            std::lock_guard lock(mutex);
+            if (auto it = cache.find(key); it != cache.end() && it->second.write_time == write_time && it->second.size == size) {
+                return it->second.body;
+            }
+        }
+
+        /// сжатие идёт без блокировки: первые запросы одного файла могут сжать его одновременно, сохранится последний
+        std::ifstream file(path, std::ios::binary);
+        std::string content{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+        if (!file && !file.eof()) {
+            return nullptr;
+        }
+        SharedStringBody::value_type body;
+        if (auto compressed = http_compression::Compress(content, encoding, http_compression::level_once); compressed.size() < content.size()) {
+            body = std::make_shared<const std::string>(std::move(compressed));
+        }
+
+        std::lock_guard lock(mutex);
+        cache[std::move(key)] = Entry{ write_time, size, body };
+        return body;
+    }
+
+}
@@ -1,5 +1,8 @@
 ﻿#pragma once
 
+#include <map>
+#include <mutex>
+
 #include "response_utils.h"
 
 namespace http_handler {
@@ -33,6 +36,31 @@ namespace http_handler {
 
     std::string_view ContentTypeFromExtention(const std::string& ext) noexcept;
 
+    /*
+     *  Сжатые копии статических файлов: файл сжимается при первом запросе в каждой кодировке,
+     *  дальше копия из памяти отдаётся всем клиентам. Копия сверяется с размером и временем изменения файла,
+     *  поэтому изменённый файл сжимается заново.
+     */
+    class CompressedFiles {
+        CompressedFiles() = delete;
+    public:
+        /// nullptr - файл отдаётся как есть: он слишком мал или велик, не читается или сжатие его не уменьшает
+        static SharedStringBody::value_type Get(const std::string& path, http_compression::Encoding encoding);
+
+    private:
+        struct Entry {
+            fs::file_time_type write_time;
+            std::uintmax_t size = 0;
+            SharedStringBody::value_type body;
+        };
+
+        /// больше - отдаётся с диска без сжатия, чтобы не держать в памяти
+        static constexpr std::uintmax_t max_file_size = 32 * 1024 * 1024;
+
+        static std::mutex mutex;
+        static std::map<std::pair<std::string, http_compression::Encoding>, Entry> cache;
+    };
+
     class RequestFile {
         RequestFile() = delete;
     public:
@@ -138,9 +166,28 @@ namespace http_handler {
                     response = make_response_error(http::int_to_status(404u), body, body.size());
                 }
                 else {
+                    auto path = FileManager::GetAbsoluteFilePath(target);
+                    content_type = ContentTypeFromExtention(FileManager::GetExtension(target));
+                    if (http_compression::IsCompressible(content_type)) {
+                        const auto encoding = http_compression::Negotiate(req[http::field::accept_encoding]);
+                        auto encoded = encoding != http_compression::Encoding::IDENTITY ? CompressedFiles::Get(path, encoding) : nullptr;
+                        if (encoded != nullptr) {
+                            response = ResponseUtils::MakeResponse<SharedResponse>(
+                                http::status::ok,
+                                verb == http::verb::get ? encoded : SharedStringBody::value_type{},
+                                encoded->size(),
+                                http_version,
+                                keep_alive,
+                                std::make_pair(http::field::content_type, content_type),
+                                std::make_pair(http::field::cache_control, "no-cache"sv),
+                                std::make_pair(http::field::content_encoding, http_compression::ToString(encoding)),
+                                std::make_pair(http::field::vary, "Accept-Encoding"sv));
+                            break;
+                        }
+                    }
+
                     http::file_body::value_type file_get;
                     http::file_body::value_type file_head;
-                    auto path = FileManager::GetAbsoluteFilePath(target);
                     sys::error_code ec;
                     file_get.open(path.data(), beast::file_mode::read, ec);
                     if (ec) {
@@ -148,11 +195,14 @@ namespace http_handler {
                         return ErrorResponse();
                     }
 
-                    content_type = ContentTypeFromExtention(FileManager::GetExtension(target));
-                    response = make_response_file(http::status::ok,
+                    auto file_response = make_response_file(http::status::ok,
                         verb == http::verb::get ? file_get : file_head,
                         file_get.size(),
                         content_type);
+                    if (http_compression::IsCompressible(content_type)) {
+                        file_response.set(http::field::vary, "Accept-Encoding"sv);
+                    }
+                    response = std::move(file_response);
                 }
 
                 break;
@@ -183,6 +233,9 @@ namespace http_handler {
             else if (std::holds_alternative<FileResponse>(response)) {
                 response_code = std::get<FileResponse>(response).result_int();
             }
+            else if (std::holds_alternative<SharedResponse>(response)) {
+                response_code = std::get<SharedResponse>(response).result_int();
+            }
             
 
             LOG(LOG::MESSAGE_DATA)
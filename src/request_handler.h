@@ -3,13 +3,21 @@
 #include "response_utils.h"
 #include "request_file.h"
 #include "request_api.h"
+#include "admission_control.h"
+
+#include <deque>
 
 namespace http_handler {
 class RequestHandler : public std::enable_shared_from_this<RequestHandler> {
 public:
     using Strand = net::strand<net::io_context::executor_type>;
-    explicit RequestHandler(model::Game& game, Strand& api_strand)
-        : game_{ game }, api_strand_{ api_strand }{
+    /// По strand-у на каждую карту: у карты не больше одной сессии, поэтому это strand сессии.
+    /// limits - пороги отказа 503 для очереди каждого strand-а, по умолчанию отказов нет
+    explicit RequestHandler(model::Game& game, net::io_context& ioc, util::AdmissionLimits limits = {})
+        : game_{ game }, map_responses_{ game }, ioc_{ ioc }, limits_{ limits }, global_{ ioc, limits_ } {
+        for (size_t i = 0; i < game_.GetMaps().size(); ++i) {
+            session_executors_.emplace_back(ioc, limits_);
+        }
     }
 
     RequestHandler(const RequestHandler&) = delete;
@@ -21,57 +29,65 @@ public:
                     Send&& send) {
         // Обработать запрос request и отправить ответ, используя send
 
-        std::string target = FromUrlEncoding(static_cast<std::string>(req.target()));
-
-        auto target_is = [&target](std::string_view target_)->bool {
-            return target == target_;
-        };
-
-        auto target_is_single_map = [&target]()->bool {
-            std::string str(TargetAPI::TARGET_MAPS);
-            return target.find(str + "/") != std::string::npos;
-        };
-
-        auto target_is_records = [&target]()->bool {
-            std::string str(TargetAPI::TARGET_RECORDS);
-            return target.find(str) != std::string::npos;
-
-        };
-
-        auto target_is_api = [=] {
-            if (target_is(TargetAPI::TARGET_MAPS) ||
-                target_is_single_map() || 
-                target_is(TargetAPI::TARGET_JOIN) ||
-                target_is(TargetAPI::TARGET_PLAYERS) ||
-                target_is(TargetAPI::TARGET_STATE) || 
-                target_is(TargetAPI::TARGET_ACTION) || 
-                target_is_records() ||
-                target_is(TargetAPI::TARGET_TICK))
-                return true;
-            else
-                return false;
-        };
+        /// маршрут API находится один раз и дальше передаётся обработчикам; std::nullopt - запрос к файлам
+        const auto route = FindApiRoute(req.target());
+        /// запрос уходит обработчикам по значению, а ответ 500 на упавший запрос строится уже без него
+        const auto http_version = req.version();
+        const bool keep_alive = req.keep_alive();
 
-        auto execute_send = [&send] (VariantResponse&& response)->void{
+        auto execute_send = [&send, http_version, keep_alive] (VariantResponse&& response)->void{
             if (std::holds_alternative<StringResponse>(response)) {
                 send(std::get<StringResponse>(std::move(response)));
             }
             else if (std::holds_alternative<FileResponse>(response)) {
                 send(std::get<FileResponse>(std::move(response)));
             }
+            else if (std::holds_alternative<SharedResponse>(response)) {
+                send(std::get<SharedResponse>(std::move(response)));
+            }
+            else {
+                send(RequestAPI::MakeInternalError(http_version, keep_alive));
+            }
         };
         try {
-            if (target_is_api()) {
+            if (route.has_value() && RequestAPI::IsSnapshotRead(*route, req)) {
+                auto body = json_loader::ParseRequestBody(req.body());
+                if (auto wait = RequestAPI::FindTickWait(*route, req, body); wait.has_value()) {
+                    ParkUntilNextTick(std::move(wait->first), wait->second, *route, std::move(req), std::move(body), remote_endpoint, send);
+                    return;
+                }
+                Process(*route, std::move(req), body, remote_endpoint, send);
+            }
+            else if (route == ApiRoute::ADMISSION && ApiRoutes::Info(*route).Allows(req.method())) {
+                /// отчёт о нагрузке не встаёт в очереди, которые он описывает
+                execute_send(RequestAPI::MakeAdmissionReport(req, GetAdmissionStats()));
+            }
+            else if (route.has_value()) {
+                /// тело разбирается один раз: и для выбора strand-а, и для обработки
+                auto body = json_loader::ParseRequestBody(req.body());
+                Executor& executor = SelectExecutor(*route, req, body);
+                /// перегруженный strand не получает ещё одну задачу: отказ 503 уходит сразу
+                const auto kind = req.method() == http::verb::post ? util::RequestKind::WRITE : util::RequestKind::READ;
+                if (!executor.load.TryEnqueue(kind)) {
+                    execute_send(RequestAPI::MakeServiceUnavailable(req, limits_.retry_after));
+                    return;
+                }
                 auto handle = [self = shared_from_this(),
+                               route = *route,
                                req = std::forward<decltype(req)>(req),
+                               body = std::move(body),
                                send,
                                this,
+                               &executor,
+                               kind,
+                               enqueued = util::AdmissionQueue::Clock::now(),
                                remote_endpoint] {
-                    assert(self->api_strand_.running_in_this_thread());
-                    send(RequestAPI::process(std::move(req), game_, remote_endpoint));
+                    executor.load.OnStart(kind, enqueued);
+                    assert(executor.strand.running_in_this_thread());
+                    Process(route, std::move(req), body, remote_endpoint, send);
                 };
                 
-                net::dispatch(api_strand_, handle);
+                net::dispatch(executor.strand, handle);
             }
             else { //if (target_is_file())
                 execute_send(RequestFile::process(std::move(req), game_, remote_endpoint));
@@ -79,12 +95,136 @@ public:
         }
         catch(std::exception & ex){
             BOOST_LOG(my_logger::get()) << "ERROR: in process request " << ex.what() << std::endl;
+            /// при конвейере ответы пишутся по порядку: без ответа на этот запрос встали бы все следующие
+            execute_send(ErrorResponse{});
         }
     }
 
+    /// Команда не из HTTP-запроса (например, из WebSocket-а).
+    /// В режиме /tick Game::Submit выполняет команду сразу, поэтому она уходит в global_ наравне с API.
+    void SubmitCommand(model::Game::Command command) {
+        if (game_.GetTickPeriod() == model::Game::TICK_TESTING_MODE) {
+            net::dispatch(global_.strand, [&game = game_, command = std::move(command)]() mutable {
+                game.Submit(std::move(command));
+            });
+            return;
+        }
+        game_.Submit(std::move(command));
+    }
+
+    /// Очереди и отказы всех strand-ов API
+    util::AdmissionStats GetAdmissionStats() const noexcept {
+        util::AdmissionStats stats;
+        global_.load.AddTo(stats);
+        for (const auto& executor : session_executors_) {
+            executor.load.AddTo(stats);
+        }
+        return stats;
+    }
+
 private:
+    /// strand и учёт его очереди для admission control
+    struct Executor {
+        Executor(net::io_context& ioc, const util::AdmissionLimits& limits)
+            : strand{ net::make_strand(ioc) }, load{ limits } {
+        }
+
+        Strand strand;
+        util::AdmissionQueue load;
+    };
+
+    template <typename Request, typename Send>
+    struct TickWait {
+        TickWait(Strand strand, ApiRoute route, Request&& req, json_loader::RequestBody&& body, const tcp::endpoint& remote_endpoint, Send send)
+            : timer{ strand }, route{ route }, req{ std::move(req) }, body{ std::move(body) }, remote_endpoint{ remote_endpoint }, send{ std::move(send) } {
+        }
+
+        net::steady_timer timer;
+        ApiRoute route;
+        Request req;
+        json_loader::RequestBody body;
+        tcp::endpoint remote_endpoint;
+        Send send;
+        bool resumed = false;
+        /// id ожидания на сессии: по таймауту его надо снять, иначе сессия держит запрос до следующего тика
+        std::uint64_t wait_id = 0;
+    };
+
+    /*
+     * Long-poll /state?waitForTick=N: запрос ждёт на сессии следующего тика, но не дольше max_tick_wait.
+     * Тик и таймер возобновляют запрос в strand-е таймера, ответ отдаёт тот, кто успел первым.
+     * Ожидание ставится в том же strand-е, поэтому таймер видит уже известный wait_id.
+     */
+    template <typename Request, typename Send>
+    void ParkUntilNextTick(model::GameSessionSharedPtr session, std::uint64_t after_tick, ApiRoute route,
+                           Request&& req, json_loader::RequestBody&& body, const tcp::endpoint& remote_endpoint, const Send& send) {
+        using Wait = TickWait<std::decay_t<Request>, std::decay_t<Send>>;
+        auto wait = std::make_shared<Wait>(net::make_strand(ioc_), route, std::move(req), std::move(body), remote_endpoint, send);
+        auto resume = [self = shared_from_this(), wait] {
+            if (std::exchange(wait->resumed, true)) {
+                return;
+            }
+            wait->timer.cancel();
+            self->Process(wait->route, std::move(wait->req), wait->body, wait->remote_endpoint, wait->send);
+        };
+        net::dispatch(wait->timer.get_executor(), [session = std::move(session), after_tick, wait, resume] {
+            wait->timer.expires_after(RequestAPI::max_tick_wait);
+            wait->timer.async_wait([session, wait, resume](beast::error_code ec) {
+                if (ec != net::error::operation_aborted) {
+                    session->CancelTickWait(wait->wait_id);
+                }
+                resume();
+            });
+            wait->wait_id = session->WaitForNextTick(after_tick, [executor = wait->timer.get_executor(), resume] {
+                net::post(executor, resume);
+            });
+        });
+    }
+
+    /// RequestAPI::process вне operator(): упавший запрос всё равно получает ответ, а исключение не уходит в io_context
+    template <typename Request, typename Send>
+    void Process(ApiRoute route, Request&& req, const json_loader::RequestBody& body, const tcp::endpoint& remote_endpoint, const Send& send) {
+        const auto http_version = req.version();
+        const bool keep_alive = req.keep_alive();
+        try {
+            RequestAPI::process(route, std::forward<Request>(req), body, game_, map_responses_, remote_endpoint, send);
+        }
+        catch (std::exception& ex) {
+            BOOST_LOG(my_logger::get()) << "ERROR: in process request " << ex.what() << std::endl;
+            send(RequestAPI::MakeInternalError(http_version, keep_alive));
+        }
+    }
+
+    /*
+     * Запросы игроков одной сессии выполняются последовательно в её strand-е,
+     * разные сессии - параллельно. Глобальные запросы идут в global_.
+     * В режиме /tick всё API в global_: тик трогает все сессии сразу.
+     */
+    template <typename Request>
+    Executor& SelectExecutor(ApiRoute route, const Request& req, const json_loader::RequestBody& body) {
+        if (game_.GetTickPeriod() == model::Game::TICK_TESTING_MODE) {
+            return global_;
+        }
+        try {
+            if (auto index = RequestAPI::FindSessionIndex(route, req, body, game_); index.has_value()) {
+                return session_executors_[index.value()];
+            }
+        }
+        catch (std::exception&) {
+            /// разбор тела или токена не удался - ошибку вернёт RequestAPI::process
+        }
+        return global_;
+    }
+
     model::Game& game_;
-    Strand& api_strand_;
+    /// карты не меняются после загрузки игры: ответы /maps строятся один раз
+    const json_loader::MapResponses map_responses_;
+    net::io_context& ioc_;
+    /// на него ссылаются очереди исполнителей
+    const util::AdmissionLimits limits_;
+    Executor global_;
+    /// deque: Executor не перемещается, ссылки на элементы держат задачи в очереди
+    std::deque<Executor> session_executors_;
 };
 
 }  // namespace http_handler
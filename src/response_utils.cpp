@@ -41,6 +41,93 @@ std::string http_handler::FromUrlEncoding(const std::string& str) noexcept {
     return result;
 }
 
+std::string_view http_handler::TargetPath(std::string_view target) noexcept {
+    return target.substr(0, target.find('?'));
+}
+
+std::optional<http_handler::ApiRoute> http_handler::FindApiRoute(std::string_view target) {
+    std::string_view path = TargetPath(target);
+    if (path.find_first_of("%+"sv) == std::string_view::npos) {
+        return ApiRoutes::Match(path);
+    }
+    return ApiRoutes::Match(FromUrlEncoding(std::string(path)));
+}
+
+std::optional<std::string> http_handler::FindQueryParam(std::string_view target, std::string_view name) {
+    auto pos = target.find('?');
+    if (pos == std::string_view::npos) {
+        return std::nullopt;
+    }
+    std::string_view query = target.substr(pos + 1);
+    while (!query.empty()) {
+        auto pair = query.substr(0, query.find('&'));
+        query.remove_prefix(std::min(query.size(), pair.size() + 1));
+        auto eq = pair.find('=');
+        if (pair.substr(0, eq) == name) {
+            return std::string(eq == std::string_view::npos ? std::string_view{} : pair.substr(eq + 1));
+        }
+    }
+    return std::nullopt;
+}
+
+std::string http_handler::MakeTickETag(std::uint64_t tick, std::string_view variant) {
+    std::string etag = "\"";
+    etag.append(std::to_string(tick));
+    if (!variant.empty()) {
+        etag.append("-").append(variant);
+    }
+    etag.append("\"");
+    return etag;
+}
+
+std::string http_handler::EncodedETag(std::string_view etag, http_compression::Encoding encoding) {
+    std::string result(etag);
+    if (encoding == http_compression::Encoding::IDENTITY || result.size() < 2 || result.back() != '"') {
+        return result;
+    }
+    result.insert(result.size() - 1, "-"s.append(http_compression::ToString(encoding)));
+    return result;
+}
+
+void http_handler::CompressResponse(StringResponse& response, http_compression::Encoding encoding) {
+    auto content_type = response[http::field::content_type];
+    if (!http_compression::IsCompressible(content_type)) {
+        return;
+    }
+    response.set(http::field::vary, "Accept-Encoding"sv);
+    if (encoding == http_compression::Encoding::IDENTITY || response.body().size() < http_compression::min_size) {
+        return;
+    }
+    auto compressed = http_compression::Compress(response.body(), encoding, http_compression::level_per_tick);
+    if (compressed.size() >= response.body().size()) {
+        return;
+    }
+    response.body() = std::move(compressed);
+    response.content_length(response.body().size());
+    response.set(http::field::content_encoding, http_compression::ToString(encoding));
+}
+
+bool http_handler::IfNoneMatch(std::string_view if_none_match, std::string_view etag) noexcept {
+    while (!if_none_match.empty()) {
+        auto item = if_none_match.substr(0, if_none_match.find(','));
+        if_none_match.remove_prefix(std::min(if_none_match.size(), item.size() + 1));
+        while (!item.empty() && item.front() == ' ') {
+            item.remove_prefix(1);
+        }
+        while (!item.empty() && item.back() == ' ') {
+            item.remove_suffix(1);
+        }
+        /// для If-None-Match сравнение слабое: W/"42" совпадает с "42"
+        if (item.substr(0, 2) == "W/"sv) {
+            item.remove_prefix(2);
+        }
+        if (item == "*"sv || item == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
 namespace http_handler {
 
 	fs::path FileManager::root_path = {};
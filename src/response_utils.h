@@ -1,9 +1,12 @@
 ﻿#pragma once
 
 #include "http_server.h"
+#include "api_routes.h"
 #include "model.h"
 #include "json_loader.h"
+#include "http_compression.h"
 #include "logger.h"
+#include "shared_string_body.h"
 
 #include <optional>
 #include <vector>
@@ -30,12 +33,18 @@ namespace http_handler {
     using namespace logger;
     namespace fs = std::filesystem;
     // Запрос, тело которого представлено в виде строки
-    using StringRequest = http::request<http::string_body>;
+    using StringRequest = http_server::HttpRequest;
     // Ответ, тело которого представлено в виде строки
-    using StringResponse = http::response<http::string_body>;
-    using FileResponse = http::response<http::file_body>;
+    // Поля всех ответов - из пула http_server::FieldsPool, как и поля запросов
+    using StringResponse = http::response<http::string_body, http_server::PooledFields>;
+    using FileResponse = http::response<http::file_body, http_server::PooledFields>;
+    // Ответ с разделяемым между запросами телом (закешированное состояние сессии)
+    using SharedResponse = http::response<SharedStringBody, http_server::PooledFields>;
     using ErrorResponse = sys::error_code;
-    using VariantResponse = std::variant<StringResponse, FileResponse, ErrorResponse>;
+    using VariantResponse = std::variant<StringResponse, FileResponse, SharedResponse, ErrorResponse>;
+
+    static_assert(model::SessionSnapshot::body_encodings == static_cast<std::size_t>(http_compression::Encoding::COUNT),
+                  "cached bodies must have a slot for every encoding");
 
     void DumpRequest(const StringRequest& req);
 
@@ -90,13 +99,6 @@ namespace http_handler {
         constexpr static std::string_view AUDIO_MP3 = "audio/mpeg"sv;
     };
 
-    struct ResponseAllowedMethods {
-        ResponseAllowedMethods() = delete;
-        constexpr static std::string_view GET_HEAD = "GET,HEAD"sv;
-        constexpr static std::string_view POST = "POST"sv;
-        constexpr static std::string_view GET_HEAD_POST = "GET,HEAD,POST"sv;
-    };
-
     /// frequently repeating strings
     struct FreqStr {
         FreqStr() = delete;
@@ -108,19 +110,21 @@ namespace http_handler {
         constexpr static std::string_view no_cache = "no-cache"sv;
     };
 
-    struct TargetAPI {
-        TargetAPI() = delete;
-
-        constexpr static std::string_view TARGET_MAPS = "/api/v1/maps"sv;
-        constexpr static std::string_view TARGET_JOIN = "/api/v1/game/join"sv;
-        constexpr static std::string_view TARGET_PLAYERS = "/api/v1/game/players"sv;
-        constexpr static std::string_view TARGET_STATE = "/api/v1/game/state"sv;
-        constexpr static std::string_view TARGET_ACTION = "/api/v1/game/player/action"sv;
-        constexpr static std::string_view TARGET_TICK = "/api/v1/game/tick"sv;
-        constexpr static std::string_view TARGET_RECORDS = "/api/v1/game/records"sv;
-        constexpr static std::string_view TARGET_BAD = "/api/"sv;
-    };
     std::string FromUrlEncoding(const std::string& str) noexcept;
+    /// Путь без строки запроса: "/api/v1/game/state?sinceTick=3" -> "/api/v1/game/state"
+    std::string_view TargetPath(std::string_view target) noexcept;
+    /// Маршрут API по сырому target запроса. Путь декодируется, только если в нём есть '%' или '+'
+    std::optional<ApiRoute> FindApiRoute(std::string_view target);
+    /// Значение параметра name из строки запроса target, std::nullopt - параметра нет
+    std::optional<std::string> FindQueryParam(std::string_view target, std::string_view name);
+    /// ETag представления, которое меняется только с тиком сессии: "\"42\"", с вариантом "\"42-bin\""
+    std::string MakeTickETag(std::uint64_t tick, std::string_view variant = {});
+    /// ETag сжатого представления: у каждого Content-Encoding свой, "\"42\"" -> "\"42-gzip\""
+    std::string EncodedETag(std::string_view etag, http_compression::Encoding encoding);
+    /// Сжимает тело собранного ответа, если клиент принимает сжатие, тип сжимаемый и тело от этого меньше
+    void CompressResponse(StringResponse& response, http_compression::Encoding encoding);
+    /// Совпадает ли etag с одним из значений заголовка If-None-Match (список через запятую, W/, *)
+    bool IfNoneMatch(std::string_view if_none_match, std::string_view etag) noexcept;
 
     class FileManager {
         FileManager() = delete;
@@ -0,0 +1,54 @@
+#pragma once
+#include "sdk.h"
+
+#include <memory>
+#include <string>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/optional.hpp>
+
+namespace http_handler {
+
+/*
+ *  Тело ответа - разделяемая неизменяемая строка.
+ *  Один и тот же буфер отдаётся всем запросившим без копирования,
+ *  строка живёт, пока её держит хотя бы один ответ в процессе записи.
+ *  nullptr - пустое тело (ответ на HEAD).
+ */
+struct SharedStringBody {
+    using value_type = std::shared_ptr<const std::string>;
+
+    static std::uint64_t size(const value_type& body) noexcept {
+        return body ? body->size() : 0;
+    }
+
+    class writer {
+    public:
+        using const_buffers_type = boost::asio::const_buffer;
+
+        template <bool isRequest, class Fields>
+        writer(const boost::beast::http::header<isRequest, Fields>&, const value_type& body)
+            : body_(body) {
+        }
+
+        void init(boost::beast::error_code& ec) {
+            ec = {};
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>> get(boost::beast::error_code& ec) {
+            ec = {};
+            if (written_ || body_ == nullptr || body_->empty()) {
+                return boost::none;
+            }
+            written_ = true;
+            return { { const_buffers_type(body_->data(), body_->size()), false } };
+        }
+
+    private:
+        const value_type& body_;
+        bool written_ = false;
+    };
+};
+
+}  // namespace http_handler
@@ -0,0 +1,110 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Равномерная сетка над прямоугольником карты: выборка точек рядом с заданной без перебора всех.
+ *  Точки раскладываются по клеткам заново на каждый набор (раз в тик) сортировкой подсчётом.
+ *  Границы карты не меняются, поэтому после первого Build память сетки только переиспользуется.
+ *  Точки за границами попадают в крайние клетки.
+ */
+class SpatialGrid {
+public:
+    /// На очень больших картах клетка растёт, чтобы клеток по оси было не больше этого
+    static constexpr std::size_t max_cells_per_axis = 256;
+
+    void SetBounds(double min_x, double min_y, double max_x, double max_y, double cell_size) {
+        const double extent = std::max(max_x - min_x, max_y - min_y);
+        cell_size_ = std::max(cell_size, extent / max_cells_per_axis);
+        min_x_ = min_x;
+        min_y_ = min_y;
+        cols_ = static_cast<std::size_t>((max_x - min_x) / cell_size_) + 1;
+        rows_ = static_cast<std::size_t>((max_y - min_y) / cell_size_) + 1;
+    }
+
+    /// get_x(i), get_y(i) - координаты i-й точки, i < count
+    template <typename GetX, typename GetY>
+    void Build(std::size_t count, GetX&& get_x, GetY&& get_y) {
+        cell_start_.assign(cols_ * rows_ + 1, 0);
+        cell_of_.resize(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            cell_of_[i] = static_cast<std::uint32_t>(CellOf(get_x(i), get_y(i)));
+            ++cell_start_[cell_of_[i] + 1];
+        }
+        for (std::size_t c = 1; c < cell_start_.size(); ++c) {
+            cell_start_[c] += cell_start_[c - 1];
+        }
+        entries_.resize(count);
+        cursor_.assign(cell_start_.begin(), cell_start_.end() - 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            entries_[cursor_[cell_of_[i]]++] = Entry{ get_x(i), get_y(i), static_cast<std::uint32_t>(i) };
+        }
+    }
+
+    /// fn(i) для каждой точки не дальше radius от (x, y), по клеткам сетки
+    template <typename Fn>
+    void ForEachNear(double x, double y, double radius, Fn&& fn) const {
+        if (entries_.empty()) {
+            return;
+        }
+        const auto [col_from, row_from] = ColRow(x - radius, y - radius);
+        const auto [col_to, row_to] = ColRow(x + radius, y + radius);
+        const double radius2 = radius * radius;
+        for (std::size_t row = row_from; row <= row_to; ++row) {
+            const std::size_t first = cell_start_[row * cols_ + col_from];
+            const std::size_t last = cell_start_[row * cols_ + col_to + 1];
+            for (std::size_t e = first; e < last; ++e) {
+                const double dx = entries_[e].x - x;
+                const double dy = entries_[e].y - y;
+                if (dx * dx + dy * dy <= radius2) {
+                    fn(entries_[e].index);
+                }
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        double x;
+        double y;
+        std::uint32_t index;
+    };
+
+    std::pair<std::size_t, std::size_t> ColRow(double x, double y) const noexcept {
+        auto clamp = [this](double v, std::size_t count) -> std::size_t {
+            const double cell = std::floor(v / cell_size_);
+            if (!(cell > 0.)) {
+                return 0;
+            }
+            if (cell >= static_cast<double>(count - 1)) {
+                return count - 1;
+            }
+            return static_cast<std::size_t>(cell);
+        };
+        return { clamp(x - min_x_, cols_), clamp(y - min_y_, rows_) };
+    }
+
+    std::size_t CellOf(double x, double y) const noexcept {
+        const auto [col, row] = ColRow(x, y);
+        return row * cols_ + col;
+    }
+
+    double cell_size_ = 1.;
+    double min_x_ = 0.;
+    double min_y_ = 0.;
+    std::size_t cols_ = 1;
+    std::size_t rows_ = 1;
+    /// клетка c - это entries_[cell_start_[c], cell_start_[c + 1]); клетки идут по строкам
+    std::vector<std::uint32_t> cell_start_;
+    std::vector<Entry> entries_;
+    std::vector<std::uint32_t> cell_of_;
+    std::vector<std::uint32_t> cursor_;
+};
+
+}  // namespace util
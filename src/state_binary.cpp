@@ -0,0 +1,91 @@
+#include "state_binary.h"
+
+#include <bit>
+#include <type_traits>
+
+namespace state_binary {
+
+namespace {
+
+/// Пишет числа little-endian независимо от порядка байт машины
+class Writer {
+public:
+    explicit Writer(std::string& out) noexcept
+        : out_(out) {
+    }
+
+    template <typename T>
+    void Put(T value) {
+        using Unsigned = std::make_unsigned_t<T>;
+        auto bits = static_cast<Unsigned>(value);
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+            out_.push_back(static_cast<char>(bits & 0xff));
+            bits = static_cast<Unsigned>(bits >> 8);
+        }
+    }
+
+    void PutDouble(double value) {
+        Put(std::bit_cast<std::uint64_t>(value));
+    }
+
+    void PutBytes(const char* data, std::size_t size) {
+        out_.append(data, size);
+    }
+
+private:
+    std::string& out_;
+};
+
+}  // namespace
+
+std::string Encode(const model::SessionSnapshot& snapshot) {
+    std::size_t bag_items = 0;
+    for (const auto& dog : snapshot.dogs) {
+        bag_items += dog.bag.size();
+    }
+
+    std::string result;
+    result.reserve(header_size + snapshot.dogs.size() * player_size + snapshot.loots.size() * loot_size + bag_items * bag_item_size);
+    Writer writer(result);
+
+    writer.PutBytes(magic, sizeof(magic));
+    writer.Put(version);
+    writer.Put(static_cast<std::uint16_t>(header_size));
+    writer.Put(snapshot.tick);
+    writer.Put(static_cast<std::uint32_t>(snapshot.dogs.size()));
+    writer.Put(static_cast<std::uint32_t>(snapshot.loots.size()));
+    writer.Put(static_cast<std::uint32_t>(bag_items));
+    writer.Put(static_cast<std::uint8_t>(player_size));
+    writer.Put(static_cast<std::uint8_t>(loot_size));
+    writer.Put(static_cast<std::uint8_t>(bag_item_size));
+    writer.Put(std::uint8_t{ 0 });
+
+    for (const auto& dog : snapshot.dogs) {
+        writer.Put(dog.player_id);
+        writer.PutDouble(dog.position.x);
+        writer.PutDouble(dog.position.y);
+        writer.PutDouble(dog.speed.dx);
+        writer.PutDouble(dog.speed.dy);
+        writer.Put(static_cast<std::int32_t>(dog.score));
+        writer.Put(static_cast<std::uint16_t>(dog.bag.size()));
+        writer.Put(static_cast<std::uint8_t>(dog.dir.empty() ? 0 : dog.dir.front()));
+        writer.Put(std::uint8_t{ 0 });
+    }
+
+    for (const auto& loot : snapshot.loots) {
+        writer.Put(loot.id);
+        writer.PutDouble(loot.position.x);
+        writer.PutDouble(loot.position.y);
+        writer.Put(static_cast<std::int32_t>(loot.type));
+    }
+
+    for (const auto& dog : snapshot.dogs) {
+        for (const auto& item : dog.bag) {
+            writer.Put(item.id);
+            writer.Put(static_cast<std::int32_t>(item.type));
+        }
+    }
+    return result;
+}
+
+}  // namespace state_binary
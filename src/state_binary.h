@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "model.h"
+
+namespace state_binary {
+
+/*
+ *  Двоичное представление полного состояния сессии (/game/state с Accept: application/octet-stream).
+ *  Все числа little-endian, записи фиксированной длины, без выравнивания:
+ *
+ *  заголовок, header_size байт:
+ *      char[4] magic "DSTB", u16 version, u16 header_size, u64 tick,
+ *      u32 число игроков, u32 число предметов на карте, u32 число предметов в рюкзаках,
+ *      u8 player_size, u8 loot_size, u8 bag_item_size, u8 резерв
+ *  игрок, player_size байт, по возрастанию id собаки:
+ *      u64 id игрока, f64 x, f64 y, f64 dx, f64 dy, i32 score, u16 предметов в рюкзаке, u8 dir (ASCII, 0 - нет), u8 резерв
+ *  предмет на карте, loot_size байт:
+ *      u64 id, f64 x, f64 y, i32 type
+ *  предмет рюкзака, bag_item_size байт: рюкзаки всех игроков подряд, в порядке игроков:
+ *      u64 id, i32 type
+ *
+ *  Новые поля добавляются в конец записи с увеличением version; клиент пропускает header_size байт заголовка
+ *  и шагает по записям на размеры из заголовка, поэтому старый клиент читает новые версии, не зная новых полей.
+ *  Декодер для браузера - static/js/state_binary.js.
+ */
+constexpr char magic[4] = { 'D', 'S', 'T', 'B' };
+constexpr std::uint16_t version = 1;
+constexpr std::size_t header_size = 32;
+constexpr std::size_t player_size = 48;
+constexpr std::size_t loot_size = 28;
+constexpr std::size_t bag_item_size = 12;
+static_assert(player_size <= 0xFF && loot_size <= 0xFF && bag_item_size <= 0xFF, "record sizes are stored in one byte");
+
+std::string Encode(const model::SessionSnapshot& snapshot);
+
+}  // namespace state_binary
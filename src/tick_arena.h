@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Арена для временных объектов одного тика игры.
+ *  Всё, что выделено через Resource() за тик, освобождается разом в Reset().
+ *  Если за тик собственного буфера не хватило, Reset() увеличивает буфер,
+ *  поэтому в установившемся режиме тик не обращается к глобальной куче.
+ */
+class TickArena {
+public:
+    explicit TickArena(std::size_t initial_size = 64 * 1024)
+        : buffer_(initial_size) {
+        resource_.emplace(buffer_.data(), buffer_.size(), &overflow_);
+    }
+
+    TickArena(const TickArena&) = delete;
+    TickArena& operator=(const TickArena&) = delete;
+
+    std::pmr::memory_resource* Resource() noexcept {
+        return &*resource_;
+    }
+
+    void Reset() {
+        if (overflow_.Bytes() == 0) {
+            resource_->release();
+            return;
+        }
+        const std::size_t new_size = 2 * (buffer_.size() + overflow_.Bytes());
+        resource_.reset();
+        overflow_.ResetBytes();
+        buffer_ = std::vector<std::byte>(new_size);
+        resource_.emplace(buffer_.data(), buffer_.size(), &overflow_);
+    }
+
+    std::size_t Capacity() const noexcept {
+        return buffer_.size();
+    }
+
+private:
+    // Выделяет память в глобальной куче и считает, сколько арена запросила сверх буфера
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        std::size_t Bytes() const noexcept {
+            return bytes_;
+        }
+        void ResetBytes() noexcept {
+            bytes_ = 0;
+        }
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            bytes_ += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        std::size_t bytes_ = 0;
+    };
+
+    std::vector<std::byte> buffer_;
+    OverflowResource overflow_;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+};
+
+}  // namespace util
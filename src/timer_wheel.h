@@ -0,0 +1,152 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Иерархическое колесо таймеров.
+ *  Время - целое число единиц (в игре - миллисекунды игрового времени).
+ *  4 уровня по 64 слота покрывают 2^24 единиц вперёд от текущего времени,
+ *  более дальние таймеры лежат в overflow_ и раскладываются по колёсам при обороте верхнего уровня.
+ *
+ *  Отмены нет: владелец ключа сам проверяет в обработчике, актуален ли сработавший таймер.
+ */
+template <typename Key>
+class TimerWheel {
+public:
+    using Time = std::uint64_t;
+
+    explicit TimerWheel(Time now = 0)
+        : current_(now) {
+    }
+
+    /*
+     * Ставит таймер на момент expiry.
+     * Таймер из прошлого сработает при ближайшем вызове Advance.
+     */
+    void Schedule(Key key, Time expiry) {
+        Place(Entry{ key, expiry < current_ ? current_ : expiry });
+        ++size_;
+    }
+
+    /*
+     * Продвигает время до now включительно и вызывает fn(key, expiry)
+     * для каждого таймера с expiry <= now в порядке возрастания expiry.
+     */
+    template <typename Fn>
+    void Advance(Time now, Fn&& fn) {
+        while (current_ <= now) {
+            if (size_ == 0) {
+                current_ = now + 1;
+                return;
+            }
+            Cascade();
+            auto& slot = wheels_[0][current_ & slot_mask];
+            if (slot.empty()) {
+                // пустые слоты не обходим по одному: большой шаг времени не должен стоить шагов по единице
+                current_ = std::min(NextEvent(), now + 1);
+                continue;
+            }
+            // fn может поставить таймер на current_ в этот же слот, поэтому обходим по индексу.
+            // Слот очищается без освобождения памяти, чтобы не выделять её заново на следующем обороте
+            for (std::size_t i = 0; i < slot.size(); ++i) {
+                const Entry entry = slot[i];
+                --size_;
+                fn(entry.key, entry.expiry);
+            }
+            slot.clear();
+            ++current_;
+        }
+    }
+
+    std::size_t Size() const noexcept {
+        return size_;
+    }
+
+    Time Now() const noexcept {
+        return current_;
+    }
+
+private:
+    static constexpr unsigned slot_bits = 6;
+    static constexpr std::size_t slots = std::size_t(1) << slot_bits;
+    static constexpr Time slot_mask = slots - 1;
+    static constexpr unsigned levels = 4;
+
+    struct Entry {
+        Key key;
+        Time expiry;
+    };
+
+    void Place(const Entry& entry) {
+        for (unsigned level = 0; level < levels; ++level) {
+            const unsigned upper_shift = slot_bits * (level + 1);
+            if ((entry.expiry >> upper_shift) == (current_ >> upper_shift)) {
+                wheels_[level][(entry.expiry >> (slot_bits * level)) & slot_mask].push_back(entry);
+                return;
+            }
+        }
+        overflow_.push_back(entry);
+    }
+
+    /*
+     * Ближайший момент после current_, когда Advance есть что делать: непустой слот нижнего уровня
+     * или начало непустого слота верхнего, на котором его таймеры спускаются вниз.
+     * Таймеры уровня всегда лежат в слотах после текущего, поэтому события раньше первого найденного нет.
+     */
+    Time NextEvent() const noexcept {
+        for (unsigned level = 0; level < levels; ++level) {
+            const unsigned shift = slot_bits * level;
+            const unsigned upper_shift = shift + slot_bits;
+            for (std::size_t index = ((current_ >> shift) & slot_mask) + 1; index < slots; ++index) {
+                if (!wheels_[level][index].empty()) {
+                    return ((current_ >> upper_shift) << upper_shift) | (Time(index) << shift);
+                }
+            }
+        }
+        // колёса дальше пусты: следующее событие - оборот верхнего уровня, на нём разбирается overflow_
+        const unsigned top_shift = slot_bits * levels;
+        return ((current_ >> top_shift) + 1) << top_shift;
+    }
+
+    // На границе оборота уровня раскладываем его текущий слот по нижним уровням, начиная с верхнего
+    void Cascade() {
+        if ((current_ & slot_mask) != 0) {
+            return;
+        }
+        unsigned top = 1;
+        while (top < levels && (current_ & ((Time(1) << (slot_bits * (top + 1))) - 1)) == 0) {
+            ++top;
+        }
+        if (top == levels) {
+            Redistribute(overflow_);
+            top = levels - 1;
+        }
+        for (unsigned level = top; level >= 1; --level) {
+            Redistribute(wheels_[level][(current_ >> (slot_bits * level)) & slot_mask]);
+        }
+    }
+
+    void Redistribute(std::vector<Entry>& entries) {
+        if (entries.empty()) {
+            return;
+        }
+        // буферы слотов и scratch_ переходят друг к другу, новая память не нужна
+        scratch_.swap(entries);
+        for (const auto& entry : scratch_) {
+            Place(entry);
+        }
+        scratch_.clear();
+    }
+
+    std::array<std::array<std::vector<Entry>, slots>, levels> wheels_;
+    std::vector<Entry> overflow_;
+    std::vector<Entry> scratch_;
+    Time current_;
+    std::size_t size_ = 0;
+};
+
+}  // namespace util
@@ -173,6 +173,7 @@ class GameState {
       self.playersLoaded = true;
       self._startGame();
     });
+    this._openSocket();
   }
 
   tick() {
@@ -183,7 +184,7 @@ class GameState {
     if (!this.started)
       return false;
 
-    if ((this.ticks % this.posUpdateInterval == 0 || this.requestInstantUpdate) && !this.updateInProgress) {
+    if ((this.ticks % this.posUpdateInterval == 0 || this.requestInstantUpdate) && !this.updateInProgress && !this._socketOpen()) {
       this.requestInstantUpdate = false;
       this._updateState(function() {
         self._applyDesiredState();
@@ -212,6 +213,13 @@ class GameState {
 
   _pressKey(keys, then) {
     const self = this;
+    if (this._socketOpen()) {
+      this.socket.send(JSON.stringify({
+        move: keys
+      }));
+      then();
+      return;
+    }
     $.post({
       url: '/api/v1/game/player/action',
       dataType: 'json',
@@ -409,21 +417,64 @@ class GameState {
     return abandonedLoot;
   }
 
+  // Состояние запрашивается в двоичном виде (js/state_binary.js), сервер может ответить и JSON
   _updateState(then) {
     let self = this;
-    $.get({
-      url: '/api/v1/game/state',
-      dataType: 'json',
-      beforeSend: function(xhr) {
-        xhr.setRequestHeader("Authorization", "Bearer " + Cookies.get('authToken'));
+    fetch('/api/v1/game/state', {
+      headers: {
+        'Authorization': 'Bearer ' + Cookies.get('authToken'),
+        'Accept': 'application/octet-stream, application/json'
       }
-    }).done(function(x){
+    }).then(function(response) {
+      if (!response.ok)
+        throw new Error('state request failed: ' + response.status);
+      if (response.headers.get('Content-Type') === 'application/octet-stream')
+        return response.arrayBuffer().then(decodeStateBinary);
+      return response.json();
+    }).then(function(x){
       self.desiredState = x;
       self.stateTime = performance.now();
       then();
     })
   }
 
+  // Сервер присылает изменения после каждого тика; пока сокет открыт, состояние не опрашивается
+  _openSocket() {
+    if (typeof WebSocket === 'undefined')
+      return;
+    const self = this;
+    const scheme = location.protocol === 'https:' ? 'wss' : 'ws';
+    this.socket = new WebSocket(scheme + '://' + location.host + '/api/v1/game/ws?token=' + Cookies.get('authToken'));
+    this.socket.onmessage = function(event) {
+      self._mergeState(JSON.parse(event.data));
+      self.stateTime = performance.now();
+      if (self.started) {
+        self._applyDesiredState();
+      } else {
+        self.stateLoaded = true;
+        self._startGame();
+      }
+    };
+    this.socket.onclose = function() {
+      self.socket = undefined;
+    };
+  }
+
+  _socketOpen() {
+    return this.socket !== undefined && this.socket.readyState === WebSocket.OPEN;
+  }
+
+  _mergeState(delta) {
+    if (delta.full || this.desiredState === undefined) {
+      this.desiredState = {players: {}, lostObjects: {}};
+    }
+    const state = this.desiredState;
+    Object.assign(state.players, delta.players);
+    Object.assign(state.lostObjects, delta.lostObjects);
+    (delta.removedPlayers || []).forEach(id => delete state.players[id]);
+    (delta.removedLostObjects || []).forEach(id => delete state.lostObjects[id]);
+  }
+
   _interpolateRotation(old_pos, new_pos) {
     const pi = Math.PI;
     const rot_speed = pi / 300;
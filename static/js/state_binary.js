@@ -0,0 +1,61 @@
+// Декодер двоичного состояния сессии: GET /api/v1/game/state с Accept: application/octet-stream.
+// Формат описан в src/state_binary.h; результат такой же, как JSON-ответ /state.
+// Поля записей, которые знает этот декодер, появились в версии 1. Более новые версии только дописывают
+// поля в конец записей, поэтому по записям шагаем на размеры из заголовка, а не на свои.
+const STATE_BINARY_VERSION = 1;
+const STATE_BINARY_PLAYER_SIZE = 48;
+const STATE_BINARY_LOOT_SIZE = 28;
+const STATE_BINARY_BAG_ITEM_SIZE = 12;
+
+function decodeStateBinary(buffer) {
+  const view = new DataView(buffer);
+  const magic = String.fromCharCode(view.getUint8(0), view.getUint8(1), view.getUint8(2), view.getUint8(3));
+  if (magic !== 'DSTB') {
+    throw new Error('Not a binary game state');
+  }
+  const version = view.getUint16(4, true);
+  if (version < STATE_BINARY_VERSION) {
+    throw new Error('Unsupported binary game state version ' + version);
+  }
+  const headerSize = view.getUint16(6, true);
+  const tick = Number(view.getBigUint64(8, true));
+  const playerCount = view.getUint32(16, true);
+  const lootCount = view.getUint32(20, true);
+  const playerSize = view.getUint8(28);
+  const lootSize = view.getUint8(29);
+  const bagItemSize = view.getUint8(30);
+  if (playerSize < STATE_BINARY_PLAYER_SIZE || lootSize < STATE_BINARY_LOOT_SIZE || bagItemSize < STATE_BINARY_BAG_ITEM_SIZE) {
+    throw new Error('Malformed binary game state header');
+  }
+
+  // id больше 2^53 в игре не встречаются, а ключи объектов всё равно строки
+  const readId = offset => view.getBigUint64(offset, true).toString();
+
+  const state = { players: {}, lostObjects: {}, tick: tick };
+  const players = [];
+  let offset = headerSize;
+  for (let i = 0; i < playerCount; i++, offset += playerSize) {
+    const dir = view.getUint8(offset + 46);
+    const player = {
+      pos: [view.getFloat64(offset + 8, true), view.getFloat64(offset + 16, true)],
+      speed: [view.getFloat64(offset + 24, true), view.getFloat64(offset + 32, true)],
+      dir: dir === 0 ? '' : String.fromCharCode(dir),
+      bag: [],
+      score: view.getInt32(offset + 40, true)
+    };
+    state.players[readId(offset)] = player;
+    players.push({ player: player, bagSize: view.getUint16(offset + 44, true) });
+  }
+  for (let i = 0; i < lootCount; i++, offset += lootSize) {
+    state.lostObjects[readId(offset)] = {
+      type: view.getInt32(offset + 24, true),
+      pos: [view.getFloat64(offset + 8, true), view.getFloat64(offset + 16, true)]
+    };
+  }
+  for (const { player, bagSize } of players) {
+    for (let i = 0; i < bagSize; i++, offset += bagItemSize) {
+      player.bag.push({ id: Number(view.getBigUint64(offset, true)), type: view.getInt32(offset + 8, true) });
+    }
+  }
+  return state;
+}
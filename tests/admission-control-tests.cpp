@@ -0,0 +1,93 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+
+#include "../src/admission_control.h"
+
+using namespace std::literals;
+using util::AdmissionQueue;
+using util::RequestKind;
+
+SCENARIO("Admission control of an executor queue") {
+    util::AdmissionLimits limits;
+
+    GIVEN("no limits") {
+        AdmissionQueue queue(limits);
+        THEN("every request is admitted and counted as queued") {
+            for (int i = 0; i < 100; ++i) {
+                CHECK(queue.TryEnqueue(RequestKind::READ));
+            }
+            CHECK(queue.Queued(RequestKind::READ) == 100);
+            CHECK(queue.Shed(RequestKind::READ) == 0);
+        }
+    }
+
+    GIVEN("separate depth budgets for reads and writes") {
+        limits.reads.max_queued = 2;
+        limits.writes.max_queued = 3;
+        AdmissionQueue queue(limits);
+
+        WHEN("the read budget is used up") {
+            CHECK(queue.TryEnqueue(RequestKind::READ));
+            CHECK(queue.TryEnqueue(RequestKind::READ));
+            THEN("further reads are shed, writes are still admitted") {
+                CHECK_FALSE(queue.TryEnqueue(RequestKind::READ));
+                CHECK(queue.Shed(RequestKind::READ) == 1);
+                CHECK(queue.Queued(RequestKind::READ) == 2);
+                CHECK(queue.TryEnqueue(RequestKind::WRITE));
+                CHECK(queue.TryEnqueue(RequestKind::WRITE));
+                CHECK(queue.TryEnqueue(RequestKind::WRITE));
+                CHECK_FALSE(queue.TryEnqueue(RequestKind::WRITE));
+                CHECK(queue.Shed(RequestKind::WRITE) == 1);
+            }
+            AND_WHEN("a queued read starts") {
+                queue.OnStart(RequestKind::READ, AdmissionQueue::Clock::now());
+                THEN("a new read fits again") {
+                    CHECK(queue.TryEnqueue(RequestKind::READ));
+                }
+            }
+        }
+    }
+
+    GIVEN("a wait budget for reads only") {
+        limits.reads.max_wait = 10ms;
+        AdmissionQueue queue(limits);
+        REQUIRE(queue.TryEnqueue(RequestKind::WRITE));
+        REQUIRE(queue.TryEnqueue(RequestKind::WRITE));
+
+        WHEN("the last started request waited longer than the budget") {
+            queue.OnStart(RequestKind::WRITE, AdmissionQueue::Clock::now() - 50ms);
+            CHECK(queue.LastWait() >= 50ms);
+            THEN("reads are shed while something is queued, writes are not") {
+                CHECK_FALSE(queue.TryEnqueue(RequestKind::READ));
+                CHECK(queue.TryEnqueue(RequestKind::WRITE));
+            }
+            AND_WHEN("the queue drains") {
+                queue.OnStart(RequestKind::WRITE, AdmissionQueue::Clock::now() - 50ms);
+                THEN("a read is admitted: it will not wait behind anything") {
+                    CHECK(queue.TryEnqueue(RequestKind::READ));
+                }
+            }
+        }
+    }
+
+    GIVEN("several queues") {
+        limits.reads.max_queued = 1;
+        AdmissionQueue first(limits);
+        AdmissionQueue second(limits);
+        first.TryEnqueue(RequestKind::READ);
+        first.TryEnqueue(RequestKind::READ);
+        second.TryEnqueue(RequestKind::WRITE);
+        second.OnStart(RequestKind::WRITE, AdmissionQueue::Clock::now() - 5ms);
+
+        THEN("their stats add up") {
+            util::AdmissionStats stats;
+            first.AddTo(stats);
+            second.AddTo(stats);
+            CHECK(stats.queued[0] == 1);
+            CHECK(stats.queued[1] == 0);
+            CHECK(stats.shed[0] == 1);
+            CHECK(stats.max_last_wait >= 5ms);
+        }
+    }
+}
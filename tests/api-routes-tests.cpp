@@ -0,0 +1,53 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/api_routes.h"
+
+using namespace http_handler;
+namespace http = boost::beast::http;
+
+SCENARIO("API route table") {
+    GIVEN("the paths of all API endpoints") {
+        THEN("every exact path is found by the perfect hash") {
+            for (const auto& info : ApiRoutes::routes) {
+                if (info.route == ApiRoute::SINGLE_MAP) {
+                    continue;
+                }
+                CHECK(ApiRoutes::Match(info.path) == info.route);
+                CHECK(ApiRoutes::Info(info.route).path == info.path);
+            }
+        }
+        THEN("a map id after /api/v1/maps/ selects the single map route") {
+            CHECK(ApiRoutes::Match("/api/v1/maps/map1"sv) == ApiRoute::SINGLE_MAP);
+            CHECK(ApiRoutes::Match("/api/v1/maps/"sv) == std::nullopt);
+        }
+        THEN("unknown and almost matching paths are not routed") {
+            CHECK(ApiRoutes::Match(""sv) == std::nullopt);
+            CHECK(ApiRoutes::Match("/"sv) == std::nullopt);
+            CHECK(ApiRoutes::Match("/api/v1/game/stat"sv) == std::nullopt);
+            CHECK(ApiRoutes::Match("/api/v1/game/state/"sv) == std::nullopt);
+            CHECK(ApiRoutes::Match("/api/v1/game/records2"sv) == std::nullopt);
+            CHECK(ApiRoutes::Match("/index.html"sv) == std::nullopt);
+        }
+        THEN("routing works at compile time") {
+            static_assert(ApiRoutes::Match("/api/v1/game/state") == ApiRoute::STATE);
+            static_assert(ApiRoutes::Match("/api/v1/game/join/bulk") == ApiRoute::JOIN_BULK);
+        }
+    }
+
+    GIVEN("method sets of the routes") {
+        THEN("read routes allow GET and HEAD only") {
+            const auto& state = ApiRoutes::Info(ApiRoute::STATE);
+            CHECK(state.Allows(http::verb::get));
+            CHECK(state.Allows(http::verb::head));
+            CHECK_FALSE(state.Allows(http::verb::post));
+            CHECK(state.allow == ResponseAllowedMethods::GET_HEAD);
+        }
+        THEN("command routes allow POST only") {
+            const auto& action = ApiRoutes::Info(ApiRoute::ACTION);
+            CHECK(action.Allows(http::verb::post));
+            CHECK_FALSE(action.Allows(http::verb::get));
+            CHECK_FALSE(action.Allows(http::verb::put));
+            CHECK(action.allow == ResponseAllowedMethods::POST);
+        }
+    }
+}
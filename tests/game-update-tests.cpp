@@ -0,0 +1,365 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "../src/application.h"
+#include "../src/model.h"
+
+using namespace model;
+using namespace std::literals;
+
+namespace {
+
+std::atomic<std::size_t> allocations_count{ 0 };
+
+}  // namespace
+
+/// считаем все выделения глобальной кучи в тестовом бинарнике
+void* operator new(std::size_t size) {
+    ++allocations_count;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+/// игра с тиком 100 мс и одной картой: горизонтальная дорога 0..100 и один тип трофеев.
+/// Сценарии донастраивают карту до создания сессии
+struct Fixture {
+    Game game;
+    MapSharedPtr map = std::make_shared<Map>(Map::Id{ "map1"s }, "Map 1"s);
+
+    Fixture() {
+        game.SetTickPeriod(100);
+        game.SetRandomizeSpawnPoint(false);
+        game.SetDogRetirementTime(60 * 60 * 1000);
+        game.SetLootConfig(LootConfig{ 1000., 0. });
+
+        map->AddRoad(Road{ Road::HORIZONTAL, { 0, 0 }, 100 });
+        map->AddLootType(LootType{ "loot0"s, {}, 10, {} });
+        game.AddMap(map);
+    }
+};
+
+}  // namespace
+
+SCENARIO_METHOD(Fixture, "Game update steady state") {
+    GIVEN("a game with one running dog and loot away from its path") {
+        map->AddRoad(Road{ Road::VERTICAL, { 50, 10 }, 40 });
+        map->SetBagCapacity(3);
+        map->AddLootType(LootType{ "loot1"s, {}, 20, {} });
+        game.SetLootConfig(LootConfig{ 1000., 0.5 });
+
+        auto dog = std::make_shared<Dog>("Rex"s);
+        auto session = game.AddDogToSession(dog, Map::Index{ 0 });
+        REQUIRE(session.has_value());
+        dog->SetDirection(DIRECTION::RIGHT);
+        dog->SetSpeed({ 1., 0. });
+        (*session)->AddLoot(std::make_shared<Loot>(0, MapPoint{ 50., 30. }, 10));
+        (*session)->AddLoot(std::make_shared<Loot>(1, MapPoint{ 50., 35. }, 20));
+
+        WHEN("the world is updated after warm-up ticks") {
+            for (std::size_t i = 0; i < 2 * SessionSnapshot::changes_history; ++i) {
+                game.Update(100ms);
+            }
+            const auto start_pos = dog->GetPosition();
+            const auto allocations_before = allocations_count.load();
+            for (int i = 0; i < 100; ++i) {
+                game.Update(100ms);
+            }
+            const auto allocations_after = allocations_count.load();
+
+            THEN("ticks do not touch the global heap") {
+                CHECK(dog->GetPosition().x > start_pos.x);
+                CHECK((*session)->GetLoots().size() == 2);
+                CHECK(allocations_after == allocations_before);
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Game commands") {
+    GIVEN("a game driven by its own ticker") {
+        WHEN("a command is submitted") {
+            int executed = 0;
+            game.Submit([&executed] {
+                ++executed;
+            });
+
+            THEN("it runs at the start of the next tick, exactly once") {
+                CHECK(executed == 0);
+                game.Update(100ms);
+                CHECK(executed == 1);
+                game.Update(100ms);
+                CHECK(executed == 1);
+            }
+        }
+    }
+
+    GIVEN("a game in manual tick mode") {
+        game.SetTickPeriod(Game::TICK_TESTING_MODE);
+
+        WHEN("a command is submitted") {
+            int executed = 0;
+            game.Submit([&executed] {
+                ++executed;
+            });
+
+            THEN("it runs immediately") {
+                CHECK(executed == 1);
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Session snapshots") {
+    GIVEN("a session with a running dog") {
+        auto dog = std::make_shared<Dog>("Rex"s);
+        auto session = game.AddDogToSession(dog, Map::Index{ 0 });
+        REQUIRE(session.has_value());
+        dog->SetDirection(DIRECTION::RIGHT);
+        dog->SetSpeed({ 1., 0. });
+
+        WHEN("a reader holds a snapshot while ticks go on") {
+            game.Update(1000ms);
+            auto held = (*session)->GetSnapshot();
+            game.Update(1000ms);
+            auto fresh = (*session)->GetSnapshot();
+
+            THEN("the held snapshot is unchanged and the fresh one shows the new position") {
+                REQUIRE(held->FindDog(dog->GetId()) != nullptr);
+                REQUIRE(fresh->FindDog(dog->GetId()) != nullptr);
+                CHECK(held->FindDog(dog->GetId())->position.x == 1.);
+                CHECK(fresh->FindDog(dog->GetId())->position.x == 2.);
+                CHECK(fresh->FindDog(dog->GetId())->dir == "R"s);
+                CHECK(fresh->FindDog(dog->GetId() + 1) == nullptr);
+            }
+        }
+
+        WHEN("a cached body is requested several times within one tick") {
+            game.Update(100ms);
+            auto snapshot = (*session)->GetSnapshot();
+            int serializations = 0;
+            auto make = [&serializations] {
+                ++serializations;
+                return "{}"s;
+            };
+            auto first = snapshot->GetBody(SessionSnapshot::CachedBody::STATE, make);
+            auto second = snapshot->GetBody(SessionSnapshot::CachedBody::STATE, make);
+
+            THEN("it is serialized once and shared") {
+                CHECK(serializations == 1);
+                CHECK(first == second);
+            }
+            THEN("the next tick serializes it again") {
+                game.Update(100ms);
+                (*session)->GetSnapshot()->GetBody(SessionSnapshot::CachedBody::STATE, make);
+                CHECK(serializations == 2);
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Bulk join") {
+    GIVEN("a map without a session") {
+        game.SetRandomizeSpawnPoint(true);
+
+        WHEN("several dogs join at once") {
+            std::vector<DogSharedPtr> dogs;
+            for (int i = 0; i < 5; ++i) {
+                dogs.push_back(std::make_shared<Dog>("Dog"s + std::to_string(i)));
+            }
+            auto session = game.AddDogsToSession(dogs, Map::Index{ 0 });
+
+            THEN("one session gets all of them, placed on the road and published") {
+                REQUIRE(session.has_value());
+                CHECK(game.FindSession(Map::Index{ 0 }) == *session);
+                CHECK((*session)->GetDogs().size() == dogs.size());
+                for (const auto& dog : dogs) {
+                    CHECK(dog->GetPosition().y == 0.);
+                    CHECK(dog->GetPosition().x >= 0.);
+                    CHECK(dog->GetPosition().x <= 100.);
+                    CHECK((*session)->GetSnapshot()->FindDog(dog->GetId()) != nullptr);
+                }
+            }
+        }
+
+        WHEN("dogs join a map that does not exist") {
+            auto session = game.AddDogsToSession({ std::make_shared<Dog>("Rex"s) }, Map::Index{ 1 });
+
+            THEN("nothing is added") {
+                CHECK_FALSE(session.has_value());
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Waiting for the next tick") {
+    GIVEN("a session that has published a snapshot") {
+        auto session = game.AddDogToSession(std::make_shared<Dog>("Rex"s), Map::Index{ 0 });
+        REQUIRE(session.has_value());
+        const auto tick = (*session)->GetSnapshot()->tick;
+
+        WHEN("a waiter asks for a tick after the published one") {
+            int woken = 0;
+            (*session)->WaitForNextTick(tick, [&woken] {
+                ++woken;
+            });
+
+            THEN("it is woken once by the next tick") {
+                CHECK(woken == 0);
+                game.Update(100ms);
+                CHECK(woken == 1);
+                game.Update(100ms);
+                CHECK(woken == 1);
+            }
+        }
+
+        WHEN("a waiter asks for a tick that is already published") {
+            int woken = 0;
+            (*session)->WaitForNextTick(tick - 1, [&woken] {
+                ++woken;
+            });
+
+            THEN("it is woken immediately") {
+                CHECK(woken == 1);
+            }
+        }
+
+        WHEN("a waiter is cancelled before the next tick") {
+            int woken = 0;
+            const auto wait_id = (*session)->WaitForNextTick(tick, [&woken] {
+                ++woken;
+            });
+            REQUIRE(wait_id != 0);
+            (*session)->CancelTickWait(wait_id);
+
+            THEN("the next tick does not wake it") {
+                game.Update(100ms);
+                CHECK(woken == 0);
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Session changes between ticks") {
+    GIVEN("a session with a standing dog, a running dog and loot") {
+        auto standing = std::make_shared<Dog>("Rex"s);
+        auto running = std::make_shared<Dog>("Bim"s);
+        auto session = game.AddDogToSession(standing, Map::Index{ 0 });
+        REQUIRE(session.has_value());
+        game.AddDogToSession(running, Map::Index{ 0 });
+        auto loot = std::make_shared<Loot>(0, MapPoint{ 90., 0. }, 10);
+        (*session)->AddLoot(loot);
+        game.Update(100ms);
+        const auto start_tick = (*session)->GetSnapshot()->tick;
+
+        WHEN("one dog runs for a few ticks") {
+            running->SetDirection(DIRECTION::RIGHT);
+            running->SetSpeed({ 1., 0. });
+            for (int i = 0; i < 3; ++i) {
+                game.Update(100ms);
+            }
+            auto snapshot = (*session)->GetSnapshot();
+
+            THEN("only the running dog is reported as changed") {
+                REQUIRE(snapshot->tick == start_tick + 3);
+                auto changes = snapshot->ChangesSince(start_tick);
+                REQUIRE(changes.has_value());
+                CHECK(changes->changed_dogs == std::vector<std::uint64_t>{ running->GetId() });
+                CHECK(changes->changed_loots.empty());
+                CHECK(changes->removed_players.empty());
+                CHECK(changes->removed_loots.empty());
+            }
+            THEN("nothing changed since the current tick") {
+                auto changes = snapshot->ChangesSince(snapshot->tick);
+                REQUIRE(changes.has_value());
+                CHECK(changes->changed_dogs.empty());
+            }
+            THEN("a tick from the future or older than the history needs the full state") {
+                CHECK_FALSE(snapshot->ChangesSince(snapshot->tick + 1).has_value());
+                for (std::size_t i = 0; i < SessionSnapshot::changes_history; ++i) {
+                    game.Update(100ms);
+                }
+                CHECK_FALSE((*session)->GetSnapshot()->ChangesSince(start_tick).has_value());
+            }
+        }
+
+        WHEN("a dog picks the loot up and new loot appears") {
+            map->SetBagCapacity(3);
+            running->SetBagCapacity(3);
+            running->SetPos({ 89., 0. });
+            running->SetDirection(DIRECTION::RIGHT);
+            running->SetSpeed({ 1., 0. });
+            auto new_loot = std::make_shared<Loot>(0, MapPoint{ 10., 0. }, 10);
+            (*session)->AddLoot(new_loot);
+            game.Update(2000ms);
+            auto snapshot = (*session)->GetSnapshot();
+
+            THEN("the picked loot is removed and the new one is reported") {
+                auto changes = snapshot->ChangesSince(start_tick);
+                REQUIRE(changes.has_value());
+                CHECK(changes->removed_loots == std::vector<std::uint64_t>{ loot->GetId() });
+                CHECK(changes->changed_loots == std::vector<std::uint64_t>{ new_loot->GetId() });
+                CHECK(changes->changed_dogs == std::vector<std::uint64_t>{ running->GetId() });
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Dog retirement") {
+    GIVEN("a game where idle dogs retire immediately") {
+        game.SetDogRetirementTime(0);
+        map->SetDogSpeed(1.);
+
+        auto player = app::Players::AddPlayer(game, "Rex"s, Map::Index{ 0 });
+        const auto dog_id = player->GetDog()->GetId();
+
+        WHEN("the dog runs for a tick and then stops") {
+            player->DoAction(app::ACTIONS::MOVE, "R"s);
+            game.Update(100ms);
+            REQUIRE(game.GetDogByID(dog_id) != nullptr);
+            REQUIRE_FALSE(player->IsRemoved());
+            player->DoAction(app::ACTIONS::MOVE, ""s);
+            game.Update(100ms);
+
+            THEN("it is retired and leaves the session") {
+                CHECK(player->GetSession()->GetDogs().empty());
+                CHECK(game.GetDogByID(dog_id) == nullptr);
+                CHECK_FALSE(app::Players::FindPlayerByToken(player->GetToken()).has_value());
+                CHECK(player->IsRemoved());
+            }
+        }
+
+        WHEN("a reader holds a snapshot from before the retirement") {
+            player->DoAction(app::ACTIONS::MOVE, "R"s);
+            game.Update(100ms);
+            auto held = player->GetSession()->GetSnapshot();
+            player->DoAction(app::ACTIONS::MOVE, ""s);
+            std::weak_ptr<Dog> dog = player->GetDog();
+            player.reset();
+            game.Update(100ms);
+
+            THEN("the retired dog is gone but its name in the snapshot is still readable") {
+                CHECK(dog.expired());
+                const auto* state = held->FindDog(dog_id);
+                REQUIRE(state != nullptr);
+                CHECK(*state->name == "Rex"s);
+                CHECK(state->name == util::InternedString{ "Rex"s });
+            }
+        }
+        app::Players::RemovePlayerFromGameByDogId(dog_id);
+    }
+}
@@ -0,0 +1,89 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+#include <zlib.h>
+
+#include "../src/http_compression.h"
+
+using namespace std::literals;
+using http_compression::Encoding;
+
+namespace {
+
+/// Распаковка обоих форматов: 15 + 32 - zlib сам узнаёт gzip или zlib по заголовку
+std::string Inflate(const std::string& data) {
+    z_stream stream{};
+    REQUIRE(inflateInit2(&stream, 15 + 32) == Z_OK);
+    std::string out(1 << 16, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    const int result = inflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    inflateEnd(&stream);
+    REQUIRE(result == Z_STREAM_END);
+    return out;
+}
+
+}  // namespace
+
+SCENARIO("Accept-Encoding negotiation") {
+    using http_compression::Negotiate;
+
+    CHECK(Negotiate(""sv) == Encoding::IDENTITY);
+    CHECK(Negotiate("identity"sv) == Encoding::IDENTITY);
+    CHECK(Negotiate("gzip, deflate, br"sv) == Encoding::GZIP);
+    CHECK(Negotiate("deflate"sv) == Encoding::DEFLATE);
+    CHECK(Negotiate("GZip"sv) == Encoding::GZIP);
+    CHECK(Negotiate("x-gzip"sv) == Encoding::GZIP);
+    CHECK(Negotiate("gzip;q=0.5, deflate"sv) == Encoding::DEFLATE);
+    CHECK(Negotiate("gzip ; q=0 , deflate;q=0.1"sv) == Encoding::DEFLATE);
+    CHECK(Negotiate("gzip;q=0, deflate;q=0"sv) == Encoding::IDENTITY);
+    CHECK(Negotiate("*"sv) == Encoding::GZIP);
+    CHECK(Negotiate("*;q=0"sv) == Encoding::IDENTITY);
+    CHECK(Negotiate("gzip;q=0, *"sv) == Encoding::DEFLATE);
+    CHECK(Negotiate("br"sv) == Encoding::IDENTITY);
+}
+
+SCENARIO("Response body compression") {
+    std::string body;
+    for (int i = 0; i < 200; ++i) {
+        body += R"({"id":)" + std::to_string(i) + R"(,"pos":[1.5,2.5],"dir":"U"})";
+    }
+
+    GIVEN("a repetitive JSON body") {
+        WHEN("it is compressed with gzip") {
+            auto compressed = http_compression::Compress(body, Encoding::GZIP, http_compression::level_per_tick);
+            THEN("the stream has the gzip magic, is smaller and inflates back") {
+                REQUIRE(compressed.size() > 2);
+                CHECK(static_cast<unsigned char>(compressed[0]) == 0x1f);
+                CHECK(static_cast<unsigned char>(compressed[1]) == 0x8b);
+                CHECK(compressed.size() < body.size() / 4);
+                CHECK(Inflate(compressed) == body);
+            }
+        }
+        WHEN("it is compressed with deflate") {
+            auto compressed = http_compression::Compress(body, Encoding::DEFLATE, http_compression::level_once);
+            THEN("the stream is zlib-wrapped and inflates back") {
+                REQUIRE(compressed.size() > 2);
+                CHECK(static_cast<unsigned char>(compressed[0]) == 0x78);
+                CHECK(Inflate(compressed) == body);
+            }
+        }
+    }
+
+    GIVEN("content types") {
+        CHECK(http_compression::IsCompressible("application/json"sv));
+        CHECK(http_compression::IsCompressible("text/html; charset=utf-8"sv));
+        CHECK(http_compression::IsCompressible("application/octet-stream"sv));
+        CHECK(http_compression::IsCompressible("image/svg+xml"sv));
+        CHECK_FALSE(http_compression::IsCompressible("image/png"sv));
+        CHECK_FALSE(http_compression::IsCompressible("audio/mpeg"sv));
+    }
+
+    CHECK(http_compression::ToString(Encoding::GZIP) == "gzip"sv);
+    CHECK(http_compression::ToString(Encoding::DEFLATE) == "deflate"sv);
+    CHECK(http_compression::ToString(Encoding::IDENTITY).empty());
+}
@@ -0,0 +1,114 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <boost/asio/post.hpp>
+
+#include "../src/http_server.h"
+
+using namespace std::literals;
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = net::ip::tcp;
+
+namespace {
+
+/// /throw падает до ответа, /answer-then-throw падает после ответа, остальное отвечает из другого потока
+struct Handler {
+    net::io_context& ioc;
+
+    template <typename Request, typename Send>
+    void operator()(Request&& req, const tcp::endpoint&, Send&& send) {
+        const std::string target(req.target());
+        http::response<http::string_body> response{ http::status::ok, req.version() };
+        response.keep_alive(req.keep_alive());
+        response.body() = target;
+        response.prepare_payload();
+        if (target == "/throw"s) {
+            throw std::runtime_error("handler failed");
+        }
+        if (target == "/answer-then-throw"s) {
+            send(std::move(response));
+            throw std::runtime_error("handler failed after answering");
+        }
+        net::post(ioc, [send, response = std::move(response)]() mutable {
+            send(std::move(response));
+        });
+    }
+};
+
+/// Соединение с сессией сервера на loopback; io_context крутится в своём потоке
+struct Fixture {
+    net::io_context ioc;
+    tcp::socket client{ ioc };
+    std::thread runner;
+
+    Fixture() {
+        tcp::acceptor acceptor{ ioc, { net::ip::make_address("127.0.0.1"), 0 } };
+        tcp::socket server{ ioc };
+        client.connect(acceptor.local_endpoint());
+        acceptor.accept(server);
+        std::make_shared<http_server::Session<Handler>>(std::move(server), Handler{ ioc }, nullptr)->Run();
+        runner = std::thread([this] {
+            ioc.run();
+        });
+    }
+
+    ~Fixture() {
+        beast::error_code ec;
+        client.shutdown(tcp::socket::shutdown_both, ec);
+        client.close(ec);
+        runner.join();
+    }
+
+    void Send(std::string_view requests) {
+        net::write(client, net::buffer(requests));
+    }
+
+    http::response<http::string_body> Receive() {
+        http::response<http::string_body> response;
+        http::read(client, buffer, response);
+        return response;
+    }
+
+    beast::flat_buffer buffer;
+};
+
+std::string Get(std::string_view target) {
+    return "GET "s + std::string(target) + " HTTP/1.1\r\nHost: localhost\r\n\r\n"s;
+}
+
+}  // namespace
+
+SCENARIO_METHOD(Fixture, "Pipelined requests after a failing handler") {
+    GIVEN("a connection with pipelined requests") {
+        WHEN("the first request throws before answering") {
+            Send(Get("/throw") + Get("/next"));
+
+            THEN("it gets 500 and the next request still gets its response") {
+                auto failed = Receive();
+                CHECK(failed.result() == http::status::internal_server_error);
+                auto next = Receive();
+                CHECK(next.result() == http::status::ok);
+                CHECK(next.body() == "/next"s);
+            }
+        }
+
+        WHEN("a request throws after it has already answered") {
+            Send(Get("/answer-then-throw") + Get("/next"));
+
+            THEN("only its own answer is written and the next response follows it") {
+                auto answered = Receive();
+                CHECK(answered.result() == http::status::ok);
+                CHECK(answered.body() == "/answer-then-throw"s);
+                auto next = Receive();
+                CHECK(next.result() == http::status::ok);
+                CHECK(next.body() == "/next"s);
+            }
+        }
+    }
+}
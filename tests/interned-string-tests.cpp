@@ -0,0 +1,42 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <optional>
+#include <string>
+
+#include "../src/interned_string.h"
+
+using namespace std::literals;
+
+SCENARIO("Interned strings") {
+    GIVEN("a pool with one interned name") {
+        const auto pool_size = util::InternedString::PoolSize();
+        std::optional<util::InternedString> rex{ "interned-test-Rex"sv };
+
+        THEN("equal strings share one pool entry") {
+            util::InternedString same{ "interned-test-Rex"s };
+            util::InternedString other{ "interned-test-Bim"sv };
+            CHECK(same == *rex);
+            CHECK(&*same == &**rex);
+            CHECK_FALSE(other == *rex);
+            CHECK(*other == "interned-test-Bim"s);
+            CHECK(util::InternedString::PoolSize() == pool_size + 2);
+        }
+
+        WHEN("the last reference goes away") {
+            auto copy = *rex;
+            rex.reset();
+            CHECK(util::InternedString::PoolSize() == pool_size + 1);
+            copy = util::InternedString{ "interned-test-Bim"sv };
+
+            THEN("the string leaves the pool") {
+                CHECK(util::InternedString::PoolSize() == pool_size + 1);
+                CHECK(*copy == "interned-test-Bim"s);
+            }
+            THEN("interning it again gives a fresh entry") {
+                util::InternedString again{ "interned-test-Rex"sv };
+                CHECK(*again == "interned-test-Rex"s);
+                CHECK(util::InternedString::PoolSize() == pool_size + 2);
+            }
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+#include "../src/json_writer.h"
+
+using namespace std::literals;
+
+SCENARIO("Streaming JSON writer") {
+    std::string out;
+    util::JsonWriter writer(out);
+
+    GIVEN("nested objects and arrays") {
+        WHEN("they are written") {
+            writer.BeginObject()
+                .Key("players"sv).BeginObject()
+                    .NumberKey(42).BeginObject()
+                        .Key("pos"sv).BeginArray().Number(1.5).Number(-2.).EndArray()
+                        .Key("bag"sv).BeginArray().EndArray()
+                        .Key("score"sv).Number(7)
+                    .EndObject()
+                .EndObject()
+                .Key("full"sv).Bool(true)
+                .Key("none"sv).Null()
+                .Key("tick"sv).Number(std::uint64_t{ 18446744073709551615u })
+            .EndObject();
+            THEN("commas and colons are placed between elements") {
+                CHECK(out == R"({"players":{"42":{"pos":[1.5,-2],"bag":[],"score":7}},"full":true,"none":null,"tick":18446744073709551615})");
+            }
+        }
+    }
+
+    GIVEN("doubles") {
+        WHEN("they are written") {
+            writer.BeginArray().Number(0.1).Number(10.).Number(1e300).Number(-0.25).Number(std::nan("")).EndArray();
+            THEN("the shortest round-trip form is used and non-finite values become null") {
+                CHECK(out == "[0.1,10,1e+300,-0.25,null]");
+            }
+        }
+    }
+
+    GIVEN("strings that need escaping") {
+        WHEN("they are written") {
+            writer.BeginArray().String("a\"b\\c"sv).String("line\nnext\ttab"sv).String("\x01"sv).String("Шарик"sv).EndArray();
+            THEN("quotes, backslashes and control characters are escaped, UTF-8 is kept") {
+                CHECK(out == R"(["a\"b\\c","line\nnext\ttab","\u0001","Шарик"])");
+            }
+        }
+    }
+
+    GIVEN("a buffer that already has content") {
+        out = "prefix:";
+        WHEN("prebuilt JSON is embedded") {
+            writer.BeginObject().Key("state"sv).Raw(R"({"tick":1})"sv).Key("ok"sv).Bool(false).EndObject();
+            THEN("the writer appends to the buffer") {
+                CHECK(out == R"(prefix:{"state":{"tick":1},"ok":false})");
+            }
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/mpsc_queue.h"
+
+SCENARIO("MPSC queue") {
+    GIVEN("an empty queue") {
+        util::MpscQueue<std::unique_ptr<int>> queue;
+
+        THEN("nothing can be popped") {
+            CHECK_FALSE(queue.TryPop().has_value());
+        }
+
+        WHEN("values are pushed from one thread") {
+            for (int i = 0; i < 5; ++i) {
+                queue.Push(std::make_unique<int>(i));
+            }
+
+            THEN("they are popped in the same order") {
+                for (int i = 0; i < 5; ++i) {
+                    auto value = queue.TryPop();
+                    REQUIRE(value.has_value());
+                    CHECK(**value == i);
+                }
+                CHECK_FALSE(queue.TryPop().has_value());
+            }
+        }
+    }
+
+    GIVEN("several producer threads") {
+        struct Item {
+            int producer;
+            int seq;
+        };
+        util::MpscQueue<Item> queue;
+        constexpr int producers = 4;
+        constexpr int items_per_producer = 10000;
+
+        WHEN("they push concurrently while one consumer pops") {
+            std::vector<std::thread> threads;
+            for (int p = 0; p < producers; ++p) {
+                threads.emplace_back([&queue, p] {
+                    for (int i = 0; i < items_per_producer; ++i) {
+                        queue.Push(Item{ p, i });
+                    }
+                });
+            }
+
+            std::vector<int> next_seq(producers, 0);
+            bool in_order = true;
+            int popped = 0;
+            while (popped < producers * items_per_producer) {
+                if (auto item = queue.TryPop()) {
+                    in_order &= (item->seq == next_seq[item->producer]);
+                    next_seq[item->producer] = item->seq + 1;
+                    ++popped;
+                }
+            }
+            for (auto& t : threads) {
+                t.join();
+            }
+
+            THEN("every item arrives once and each producer's order is kept") {
+                CHECK(in_order);
+                CHECK_FALSE(queue.TryPop().has_value());
+            }
+        }
+    }
+}
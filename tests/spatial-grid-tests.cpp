@@ -0,0 +1,60 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "../src/spatial_grid.h"
+
+namespace {
+
+struct Point {
+    double x;
+    double y;
+};
+
+std::vector<std::size_t> Near(const util::SpatialGrid& grid, double x, double y, double radius) {
+    std::vector<std::size_t> result;
+    grid.ForEachNear(x, y, radius, [&result](std::size_t i) {
+        result.push_back(i);
+    });
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+}  // namespace
+
+SCENARIO("Spatial grid") {
+    GIVEN("points spread over a 100x100 area with 10x10 cells") {
+        std::vector<Point> points{ { 0., 0. }, { 5., 5. }, { 15., 0. }, { 50., 50. }, { 99., 99. }, { 150., -20. } };
+        util::SpatialGrid grid;
+        grid.SetBounds(0., 0., 100., 100., 10.);
+        grid.Build(points.size(),
+            [&points](std::size_t i) { return points[i].x; },
+            [&points](std::size_t i) { return points[i].y; });
+
+        THEN("only points within the radius are reported") {
+            CHECK(Near(grid, 0., 0., 8.) == std::vector<std::size_t>{ 0, 1 });
+            CHECK(Near(grid, 0., 0., 15.) == std::vector<std::size_t>{ 0, 1, 2 });
+            CHECK(Near(grid, 50., 50., 1.) == std::vector<std::size_t>{ 3 });
+            CHECK(Near(grid, 30., 70., 5.).empty());
+        }
+        THEN("points outside the bounds are still found") {
+            CHECK(Near(grid, 150., -20., 1.) == std::vector<std::size_t>{ 5 });
+        }
+        THEN("a huge radius covers everything") {
+            CHECK(Near(grid, 50., 50., 1e9).size() == points.size());
+        }
+
+        WHEN("the grid is rebuilt for moved points") {
+            points[3] = { 1., 1. };
+            grid.Build(points.size(),
+                [&points](std::size_t i) { return points[i].x; },
+                [&points](std::size_t i) { return points[i].y; });
+
+            THEN("queries see the new positions") {
+                CHECK(Near(grid, 0., 0., 8.) == std::vector<std::size_t>{ 0, 1, 3 });
+                CHECK(Near(grid, 50., 50., 1.).empty());
+            }
+        }
+    }
+}
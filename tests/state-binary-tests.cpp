@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <bit>
+#include <cstring>
+#include <string>
+
+#include "../src/state_binary.h"
+
+namespace {
+
+template <typename T>
+T Read(const std::string& data, std::size_t offset) {
+    std::uint64_t bits = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        bits |= static_cast<std::uint64_t>(static_cast<unsigned char>(data.at(offset + i))) << (8 * i);
+    }
+    if constexpr (std::is_same_v<T, double>) {
+        return std::bit_cast<double>(bits);
+    }
+    else {
+        return static_cast<T>(bits);
+    }
+}
+
+}  // namespace
+
+SCENARIO("Binary state encoding") {
+    using namespace state_binary;
+    const util::InternedString name{ "Rex" };
+
+    GIVEN("a snapshot with a dog carrying loot and a loot on the map") {
+        model::SessionSnapshot snapshot;
+        snapshot.tick = 77;
+        model::SessionSnapshot::DogState dog{ 5, 9, name, { 1.5, -2. }, { 0., 3. }, "U", {}, 42 };
+        dog.bag.push_back(model::BagItem{ 100, 2, 10 });
+        dog.bag.push_back(model::BagItem{ 101, 0, 5 });
+        snapshot.dogs.push_back(dog);
+        snapshot.loots.push_back(model::SessionSnapshot::LootState{ 7, 3, { 4.25, 8. } });
+
+        WHEN("it is encoded") {
+            const std::string data = Encode(snapshot);
+
+            THEN("the size is fixed by the record counts") {
+                CHECK(data.size() == header_size + player_size + loot_size + 2 * bag_item_size);
+            }
+            THEN("the header carries magic, version, tick and counts") {
+                CHECK(std::memcmp(data.data(), magic, sizeof(magic)) == 0);
+                CHECK(Read<std::uint16_t>(data, 4) == version);
+                CHECK(Read<std::uint16_t>(data, 6) == header_size);
+                CHECK(Read<std::uint64_t>(data, 8) == 77);
+                CHECK(Read<std::uint32_t>(data, 16) == 1);
+                CHECK(Read<std::uint32_t>(data, 20) == 1);
+                CHECK(Read<std::uint32_t>(data, 24) == 2);
+                CHECK(Read<std::uint8_t>(data, 28) == player_size);
+                CHECK(Read<std::uint8_t>(data, 29) == loot_size);
+                CHECK(Read<std::uint8_t>(data, 30) == bag_item_size);
+            }
+            THEN("the player record follows the header") {
+                const std::size_t at = header_size;
+                CHECK(Read<std::uint64_t>(data, at) == 9);
+                CHECK(Read<double>(data, at + 8) == 1.5);
+                CHECK(Read<double>(data, at + 16) == -2.);
+                CHECK(Read<double>(data, at + 24) == 0.);
+                CHECK(Read<double>(data, at + 32) == 3.);
+                CHECK(Read<std::int32_t>(data, at + 40) == 42);
+                CHECK(Read<std::uint16_t>(data, at + 44) == 2);
+                CHECK(data.at(at + 46) == 'U');
+            }
+            THEN("loot and bag records follow the players") {
+                const std::size_t loot_at = header_size + player_size;
+                CHECK(Read<std::uint64_t>(data, loot_at) == 7);
+                CHECK(Read<double>(data, loot_at + 8) == 4.25);
+                CHECK(Read<double>(data, loot_at + 16) == 8.);
+                CHECK(Read<std::int32_t>(data, loot_at + 24) == 3);
+
+                const std::size_t bag_at = loot_at + loot_size;
+                CHECK(Read<std::uint64_t>(data, bag_at) == 100);
+                CHECK(Read<std::int32_t>(data, bag_at + 8) == 2);
+                CHECK(Read<std::uint64_t>(data, bag_at + bag_item_size) == 101);
+                CHECK(Read<std::int32_t>(data, bag_at + bag_item_size + 8) == 0);
+            }
+        }
+    }
+
+    GIVEN("an empty snapshot") {
+        model::SessionSnapshot snapshot;
+        THEN("only the header is written") {
+            CHECK(Encode(snapshot).size() == header_size);
+        }
+    }
+}
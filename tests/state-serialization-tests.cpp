@@ -18,6 +18,28 @@ struct Fixture {
     OutputArchive output_archive{strm};
 };
 
+/// раскладка DogRepr версии 0: в рюкзаке только id трофеев, без ёмкости и UUID
+struct LegacyDogRepr {
+    std::uint64_t id = 42;
+    std::string name = "Pluto"s;
+    MapPoint pos{ 42.2, 12.5 };
+    MapSpeed speed{ 2.3, -1.2 };
+    DIRECTION dir = DIRECTION::UP;
+    std::vector<std::uint64_t> id_loots_in_bag{ 7 };
+    int score = 42;
+
+    template <typename Archive>
+    void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
+        ar& id;
+        ar& name;
+        ar& pos;
+        ar& speed;
+        ar& dir;
+        ar& id_loots_in_bag;
+        ar& score;
+    }
+};
+
 }  // namespace
 
 SCENARIO_METHOD(Fixture, "Point serialization") {
@@ -45,6 +67,8 @@ SCENARIO_METHOD(Fixture, "Dog Serialization") {
             dog.SetSpeed({ 2.3, -1.2 });
             dog.SetScore(42);
             dog.SetDirection(model::DIRECTION::UP);
+            dog.SetBagCapacity(2);
+            dog.AddLoot(BagItem{ 7, 1, 10 });
             return dog;
         }();
 
@@ -66,7 +90,60 @@ SCENARIO_METHOD(Fixture, "Dog Serialization") {
                 CHECK(dog.GetSpeed() == restored.GetSpeed());
                 CHECK(dog.GetScore() == restored.GetScore());
                 CHECK(dog.GetDirection() == restored.GetDirection());
+                CHECK(dog.GetUUID() == restored.GetUUID());
+                CHECK(dog.GetBagCapacity() == restored.GetBagCapacity());
+                REQUIRE(restored.GetBag().size() == 1);
+                CHECK(dog.GetBag()[0] == restored.GetBag()[0]);
+            }
+        }
+    }
+}
+
+SCENARIO_METHOD(Fixture, "Legacy dog deserialization") {
+    GIVEN("a dog saved in the version 0 layout") {
+        output_archive << LegacyDogRepr{};
+
+        WHEN("it is read by the current DogRepr") {
+            InputArchive input_archive{strm};
+            serialization::DogRepr repr;
+            input_archive >> repr;
+
+            THEN("bag loot ids are resolved against the restored loots") {
+                auto loot = std::make_shared<Loot>(1, MapPoint{ 0., 0. }, 10);
+                loot->SetId(7);
+                const auto restored = repr.Restore({ loot });
+
+                CHECK(restored.GetName() == "Pluto"s);
+                CHECK(restored.GetId() == 42);
+                CHECK(restored.GetPosition() == MapPoint{ 42.2, 12.5 });
+                CHECK(restored.GetScore() == 42);
+                CHECK(restored.GetDirection() == DIRECTION::UP);
+                REQUIRE(restored.GetBag().size() == 1);
+                CHECK(restored.GetBag()[0] == BagItem{ 7, 1, 10 });
+            }
+            THEN("a bag loot missing from the saved loots is an error") {
+                CHECK_THROWS_AS(repr.Restore(), std::logic_error);
             }
         }
     }
 }
+
+SCENARIO("Token string conversion") {
+    GIVEN("a random token") {
+        const Token token = app::RandomToken::get();
+
+        WHEN("token is converted to string") {
+            const auto str = app::TokenToString(token);
+
+            THEN("it is 32 hex digits and converts back to the same token") {
+                CHECK(str.size() == 32);
+                CHECK(app::TokenFromString(str) == token);
+            }
+        }
+
+        THEN("malformed strings are rejected") {
+            CHECK_THROWS_AS(app::TokenFromString("123"sv), std::invalid_argument);
+            CHECK_THROWS_AS(app::TokenFromString("zz000000000000000000000000000000"sv), std::invalid_argument);
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../src/timer_wheel.h"
+
+using Wheel = util::TimerWheel<int>;
+using Fired = std::vector<std::pair<int, Wheel::Time>>;
+
+namespace {
+
+Fired AdvanceAndCollect(Wheel& wheel, Wheel::Time now) {
+    Fired fired;
+    wheel.Advance(now, [&fired](int key, Wheel::Time expiry) {
+        fired.emplace_back(key, expiry);
+    });
+    return fired;
+}
+
+}  // namespace
+
+SCENARIO("Timer wheel") {
+    GIVEN("an empty timer wheel") {
+        Wheel wheel;
+
+        WHEN("timers are scheduled at different levels") {
+            wheel.Schedule(1, 10);
+            wheel.Schedule(2, 64);
+            wheel.Schedule(3, 5000);
+            wheel.Schedule(4, 300000);
+            wheel.Schedule(5, (Wheel::Time(1) << 24) + 7);
+
+            THEN("each fires exactly when its time is reached") {
+                CHECK(AdvanceAndCollect(wheel, 9).empty());
+                CHECK(AdvanceAndCollect(wheel, 10) == Fired{ {1, 10} });
+                CHECK(AdvanceAndCollect(wheel, 63).empty());
+                CHECK(AdvanceAndCollect(wheel, 4999) == Fired{ {2, 64} });
+                CHECK(AdvanceAndCollect(wheel, 5000) == Fired{ {3, 5000} });
+                CHECK(AdvanceAndCollect(wheel, 299999).empty());
+                CHECK(AdvanceAndCollect(wheel, 300000) == Fired{ {4, 300000} });
+                CHECK(AdvanceAndCollect(wheel, (Wheel::Time(1) << 24) + 7) == Fired{ {5, (Wheel::Time(1) << 24) + 7} });
+                CHECK(wheel.Size() == 0);
+            }
+        }
+
+        WHEN("a timer is scheduled in the past") {
+            AdvanceAndCollect(wheel, 100);
+            wheel.Schedule(1, 50);
+
+            THEN("it fires on the next advance") {
+                CHECK(AdvanceAndCollect(wheel, 101) == Fired{ {1, 101} });
+            }
+        }
+
+        WHEN("time jumps far ahead while timers are pending") {
+            const Wheel::Time far = Wheel::Time(1) << 40;
+            wheel.Schedule(1, 70);
+            wheel.Schedule(2, 5'000'000'000);
+            wheel.Schedule(3, far + 3);
+
+            THEN("empty slots are skipped and timers still fire in order") {
+                CHECK(AdvanceAndCollect(wheel, far) == Fired{ {1, 70}, {2, 5'000'000'000} });
+                CHECK(wheel.Now() == far + 1);
+                CHECK(AdvanceAndCollect(wheel, far + 2).empty());
+                CHECK(AdvanceAndCollect(wheel, far + 3) == Fired{ {3, far + 3} });
+                CHECK(wheel.Size() == 0);
+            }
+        }
+
+        WHEN("many random timers are scheduled while time advances in steps") {
+            std::mt19937 gen{ 42 };
+            std::uniform_int_distribution<Wheel::Time> delay{ 0, 20000 };
+            std::uniform_int_distribution<Wheel::Time> step{ 1, 500 };
+
+            std::vector<Wheel::Time> expected;
+            Wheel::Time now = 0;
+            bool all_in_time = true;
+            std::size_t fired_count = 0;
+            for (int i = 0; i < 2000; ++i) {
+                auto expiry = now + 1 + delay(gen);
+                wheel.Schedule(i, expiry);
+                expected.push_back(expiry);
+                const auto prev_now = now;
+                now += step(gen);
+                wheel.Advance(now, [&](int key, Wheel::Time expiry) {
+                    all_in_time &= (expiry == expected[key]) && (expiry > prev_now) && (expiry <= now);
+                    ++fired_count;
+                });
+            }
+            now += 30000;
+            wheel.Advance(now, [&](int key, Wheel::Time expiry) {
+                all_in_time &= (expiry == expected[key]);
+                ++fired_count;
+            });
+
+            THEN("every timer fires once, at the first advance past its expiry") {
+                CHECK(all_in_time);
+                CHECK(fired_count == expected.size());
+                CHECK(wheel.Size() == 0);
+            }
+        }
+    }
+}